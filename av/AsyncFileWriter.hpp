@@ -0,0 +1,330 @@
+#pragma once
+
+#include <av/IOContext.hpp>
+#include <av/SPSCQueue.hpp>
+#include <av/common.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace av
+{
+
+struct AsyncFileWriterParams
+{
+	// Size of every buffer, must be a multiple of 4096 when directIO is used
+	size_t bufferSize{4 * 1024 * 1024};
+	// Number of buffers, while one is filled by the muxer the others are written to disk
+	int bufferCount{2};
+	// Bypass the page cache with O_DIRECT, so recordings don't evict data which is read back
+	bool directIO{false};
+};
+
+// File writer which copies muxed data into aligned buffers and writes full buffers to disk on its own thread,
+// so muxing never blocks on write(). Seeks back into data already handed to the disk thread (e.g. header
+// updates on trailer) wait for pending writes and are written synchronously, seeks into the current buffer patch it in memory.
+class AsyncFileWriter : NoCopyable
+{
+	struct Job
+	{
+		int buffer{-1};
+		int64_t offset{0};
+		size_t size{0};
+	};
+
+	static constexpr size_t kAlignment = 4096;
+
+	AsyncFileWriter() = default;
+
+public:
+	static Expected<Ptr<AsyncFileWriter>> create(std::string_view path, const AsyncFileWriterParams& params = {}) noexcept
+	{
+		if (params.bufferCount < 2 || params.bufferSize == 0 || params.bufferSize % kAlignment != 0)
+			RETURN_AV_ERROR("Invalid async writer buffers: {} x {} bytes", params.bufferCount, params.bufferSize);
+
+		const std::string p(path);
+
+		Ptr<AsyncFileWriter> w{new AsyncFileWriter};
+		w->params_ = params;
+
+		w->fd_ = ::open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (w->fd_ < 0)
+			RETURN_AV_ERROR("Failed to open '{}' for writing: {}", path, std::strerror(errno));
+
+		w->directFd_ = w->fd_;
+
+#ifdef O_DIRECT
+		if (params.directIO)
+		{
+			w->directFd_ = ::open(p.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+			if (w->directFd_ < 0)
+				RETURN_AV_ERROR("Failed to open '{}' with O_DIRECT: {}", path, std::strerror(errno));
+		}
+#else
+		if (params.directIO)
+			RETURN_AV_ERROR("O_DIRECT is not supported on this platform");
+#endif
+
+		w->jobs_ = makePtr<SPSCQueue<Job>>(params.bufferCount);
+		w->free_ = makePtr<SPSCQueue<int>>(params.bufferCount);
+
+		for (int i = 0; i < params.bufferCount; ++i)
+		{
+			auto* buffer = static_cast<uint8_t*>(std::aligned_alloc(kAlignment, params.bufferSize));
+			if (!buffer)
+				RETURN_AV_ERROR("Failed to allocate {} bytes buffer", params.bufferSize);
+
+			w->buffers_.emplace_back(buffer);
+			if (i > 0)
+				w->spare_.push_back(i);
+		}
+
+		w->current_ = 0;
+		w->thread_  = std::thread([w = w.get()] { w->writeLoop(); });
+
+		return w;
+	}
+
+	// Creates an output io context writing to the file, the writer is closed when the context is destroyed
+	static Expected<Ptr<IOContext>> createIO(std::string_view path, const AsyncFileWriterParams& params = {}, int bufferSize = IOContext::kDefaultBufferSize) noexcept
+	{
+		auto writerExp = create(path, params);
+		if (!writerExp)
+			FORWARD_AV_ERROR(writerExp);
+
+		auto w = writerExp.value();
+
+		return IOContext::createWriter([w](const uint8_t* buf, int size) { return w->write(buf, size); },
+		                               [w](int64_t offset, int whence) { return w->seek(offset, whence); },
+		                               bufferSize);
+	}
+
+	~AsyncFileWriter()
+	{
+		auto closeExp = close();
+		if (!closeExp)
+			LOG_AV_ERROR(closeExp.errorString());
+
+		for (auto* buffer : buffers_)
+			std::free(buffer);
+	}
+
+	// Returns the number of bytes written or a negative AVERROR code
+	int write(const uint8_t* data, int size) noexcept
+	{
+		if (int err = error_.load(std::memory_order_acquire))
+			return AVERROR(err);
+
+		const int total = size;
+
+		// overwrite of data already handed to the disk thread
+		if (pos_ < bufferOffset_)
+		{
+			const int n = (int) std::min<int64_t>(size, bufferOffset_ - pos_);
+
+			waitIdle();
+			if (int err = error_.load())
+				return AVERROR(err);
+
+			if (pwriteAll(fd_, data, n, pos_) < 0)
+				return AVERROR(errno);
+
+			pos_ += n;
+			data += n;
+			size -= n;
+		}
+
+		// overwrite inside the current buffer
+		if (size > 0 && pos_ < bufferOffset_ + (int64_t) fill_)
+		{
+			const size_t offset = pos_ - bufferOffset_;
+			const int n         = (int) std::min<int64_t>(size, fill_ - offset);
+
+			std::memcpy(buffers_[current_] + offset, data, n);
+
+			pos_ += n;
+			data += n;
+			size -= n;
+		}
+
+		// seek past the end leaves a zero filled gap
+		while (pos_ > bufferOffset_ + (int64_t) fill_)
+		{
+			const size_t n = std::min<int64_t>(params_.bufferSize - fill_, pos_ - bufferOffset_ - fill_);
+			std::memset(buffers_[current_] + fill_, 0, n);
+			fill_ += n;
+
+			if (fill_ == params_.bufferSize && !submit())
+				return AVERROR(error_.load(std::memory_order_acquire));
+		}
+
+		while (size > 0)
+		{
+			const size_t n = std::min<size_t>(params_.bufferSize - fill_, size);
+			std::memcpy(buffers_[current_] + fill_, data, n);
+
+			fill_ += n;
+			pos_ += n;
+			data += n;
+			size -= n;
+
+			if (fill_ == params_.bufferSize && !submit())
+				return AVERROR(error_.load(std::memory_order_acquire));
+		}
+
+		end_ = std::max(end_, pos_);
+
+		return total;
+	}
+
+	int64_t seek(int64_t offset, int whence) noexcept
+	{
+		switch (whence)
+		{
+			case AVSEEK_SIZE: return end_;
+			case SEEK_SET: break;
+			case SEEK_CUR: offset += pos_; break;
+			case SEEK_END: offset += end_; break;
+			default: return AVERROR(EINVAL);
+		}
+
+		if (offset < 0)
+			return AVERROR(EINVAL);
+
+		pos_ = offset;
+		return offset;
+	}
+
+	// Writes the rest of data and closes the file, called by the destructor
+	[[nodiscard]] Expected<void> close() noexcept
+	{
+		if (fd_ < 0)
+			return {};
+
+		if (thread_.joinable())
+		{
+			waitIdle();
+			jobs_->close();
+			thread_.join();
+		}
+
+		int err = error_.load();
+
+		// the tail is not aligned for O_DIRECT so it goes through the regular descriptor
+		if (!err && fill_ > 0 && pwriteAll(fd_, buffers_[current_], fill_, bufferOffset_) < 0)
+			err = errno;
+
+		fill_ = 0;
+
+		if (directFd_ != fd_ && directFd_ >= 0)
+			::close(directFd_);
+
+		if (::close(fd_) < 0 && !err)
+			err = errno;
+
+		fd_       = -1;
+		directFd_ = -1;
+
+		if (err)
+			RETURN_AV_ERROR("Async file write failed: {}", std::strerror(err));
+
+		return {};
+	}
+
+private:
+	// Hands the full current buffer to the disk thread and takes a spare one, waits for a write to complete if there is none
+	bool submit() noexcept
+	{
+		Job job{current_, bufferOffset_, fill_};
+		jobs_->push(job);
+		inFlight_++;
+
+		bufferOffset_ += (int64_t) fill_;
+		fill_ = 0;
+
+		if (spare_.empty())
+			reclaim();
+
+		current_ = spare_.back();
+		spare_.pop_back();
+
+		return !error_.load(std::memory_order_acquire);
+	}
+
+	// Waits until the disk thread has written everything submitted
+	void waitIdle() noexcept
+	{
+		while (inFlight_ > 0)
+			reclaim();
+	}
+
+	void reclaim() noexcept
+	{
+		int index = -1;
+		if (free_->pop(index))
+		{
+			spare_.push_back(index);
+			inFlight_--;
+		}
+	}
+
+	void writeLoop() noexcept
+	{
+		Job job;
+		while (jobs_->pop(job))
+		{
+			if (!error_.load(std::memory_order_relaxed) && pwriteAll(directFd_, buffers_[job.buffer], job.size, job.offset) < 0)
+				error_.store(errno, std::memory_order_release);
+
+			free_->push(job.buffer);
+		}
+	}
+
+	static int pwriteAll(int fd, const uint8_t* data, size_t size, int64_t offset) noexcept
+	{
+		while (size > 0)
+		{
+			auto n = ::pwrite(fd, data, size, offset);
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				return -1;
+			}
+
+			data += n;
+			size -= n;
+			offset += n;
+		}
+
+		return 0;
+	}
+
+private:
+	AsyncFileWriterParams params_;
+	int fd_{-1};
+	int directFd_{-1};
+	std::vector<uint8_t*> buffers_;
+	Ptr<SPSCQueue<Job>> jobs_;
+	Ptr<SPSCQueue<int>> free_;
+	std::thread thread_;
+	std::atomic<int> error_{0};
+	// muxer side state
+	std::vector<int> spare_;
+	int current_{-1};
+	int64_t bufferOffset_{0};
+	size_t fill_{0};
+	int64_t pos_{0};
+	int64_t end_{0};
+	int inFlight_{0};
+};
+
+}// namespace av
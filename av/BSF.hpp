@@ -14,7 +14,8 @@ class BSF : NoCopyable
 	{}
 
 public:
-	static Expected<Ptr<BSF>> create(const char* filters, AVCodecParameters* par)
+	// timeBase - time base of input packets, if set the output time base is available after creation
+	static Expected<Ptr<BSF>> create(const char* filters, const AVCodecParameters* par, AVRational timeBase = {})
 	{
 		AVBSFContext* bsfc  = nullptr;
 		const char* bsfName = filters;
@@ -29,6 +30,9 @@ public:
 			RETURN_AV_ERROR("Error bsf '{}' copying codec parameters: {}", bsfName, avErrorStr(err));
 		}
 
+		if (timeBase.num > 0)
+			bsfc->time_base_in = timeBase;
+
 		err = av_bsf_init(bsfc);
 		if (err < 0)
 		{
@@ -47,7 +51,30 @@ public:
 
 	std::tuple<Result, int> apply(Packet& inPkt, std::vector<Packet>& outPkts) noexcept
 	{
-		int err = av_bsf_send_packet(bsfc_, *inPkt);
+		return sendPacket(*inPkt, outPkts);
+	}
+
+	// Signals the end of stream and drains packets buffered by the filters
+	std::tuple<Result, int> flush(std::vector<Packet>& outPkts) noexcept
+	{
+		return sendPacket(nullptr, outPkts);
+	}
+
+	// Codec parameters of filtered packets, may differ from the input ones (e.g. extradata)
+	const AVCodecParameters* parOut() const noexcept
+	{
+		return bsfc_->par_out;
+	}
+
+	AVRational timeBaseOut() const noexcept
+	{
+		return bsfc_->time_base_out;
+	}
+
+private:
+	std::tuple<Result, int> sendPacket(AVPacket* inPkt, std::vector<Packet>& outPkts) noexcept
+	{
+		int err = av_bsf_send_packet(bsfc_, inPkt);
 		if (err < 0)
 		{
 			LOG_AV_ERROR("BSF packet send error: {}", avErrorStr(err));
@@ -68,7 +95,7 @@ public:
 			if (err == AVERROR(EAGAIN))
 				return {Result::kSuccess, i};
 
-			if (err == AVERROR(EOF))
+			if (err == AVERROR_EOF)
 				return {Result::kEOF, i};
 
 			if (err < 0)
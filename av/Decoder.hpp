@@ -1,11 +1,29 @@
 #pragma once
 
 #include <av/Frame.hpp>
+#include <av/Packet.hpp>
 #include <av/common.hpp>
 
+#include <algorithm>
+#include <thread>
+
 namespace av
 {
 
+enum class DecoderThreadType
+{
+	kAuto = 0,
+	kFrame,
+	kSlice,
+};
+
+struct DecoderThreading
+{
+	DecoderThreadType type{DecoderThreadType::kAuto};
+	// 0 - pick from hardware concurrency, 1 - single threaded (libavcodec default)
+	int threadCount{1};
+};
+
 class Decoder : NoCopyable
 {
 	explicit Decoder(AVCodecContext* codecContext) noexcept
@@ -13,7 +31,8 @@ class Decoder : NoCopyable
 	{}
 
 public:
-	static Expected<Ptr<Decoder>> create(AVCodec* codec, AVStream* stream, AVRational framerate = {})
+	// lowres - decode at 1/2^lowres of the native resolution, must not exceed codec->max_lowres
+	static Expected<Ptr<Decoder>> create(AVCodec* codec, AVStream* stream, AVRational framerate = {}, const DecoderThreading& threading = {}, int lowres = 0)
 	{
 		if (!av_codec_is_decoder(codec))
 			RETURN_AV_ERROR("{} is not a decoder", codec->name);
@@ -40,6 +59,19 @@ public:
 			codecContext->framerate = framerate;
 		}
 
+		setThreading(codecContext, threading);
+
+		if (lowres > 0)
+		{
+			if (lowres > codec->max_lowres)
+			{
+				avcodec_free_context(&codecContext);
+				RETURN_AV_ERROR("Decoder {} supports lowres up to {}, requested {}", codec->name, (int) codec->max_lowres, lowres);
+			}
+
+			codecContext->lowres = lowres;
+		}
+
 		AVDictionary* opts = nullptr;
 		ret                = avcodec_open2(codecContext, codecContext->codec, &opts);
 		if (ret < 0)
@@ -105,6 +137,101 @@ public:
 		return Result::kSuccess;
 	}
 
+	// Sends the packet and drains every frame the decoder has ready into the reusable frames vector,
+	// returns the result and the number of valid frames at the beginning of the vector
+	Expected<std::tuple<Result, int>> decode(Packet& packet, std::vector<Frame>& frames) noexcept
+	{
+		return sendPacket(*packet, frames);
+	}
+
+	// Enters draining mode and receives all frames buffered inside the decoder
+	Expected<std::tuple<Result, int>> flush(std::vector<Frame>& frames) noexcept
+	{
+		return sendPacket(nullptr, frames);
+	}
+
+	// Makes the decoder skip frames of the given kind, e.g. AVDISCARD_NONREF while rolling forward after a seek
+	void skipFrames(AVDiscard discard) noexcept
+	{
+		codecContext_->skip_frame = discard;
+	}
+
+	// Drops all buffered data and resets the decoder state, e.g. after a seek
+	void flushBuffers() noexcept
+	{
+		avcodec_flush_buffers(codecContext_);
+	}
+
+private:
+	Expected<std::tuple<Result, int>> sendPacket(const AVPacket* packet, std::vector<Frame>& frames) noexcept
+	{
+		for (auto& f : frames)
+			f.dataUnref();
+
+		int count = 0;
+		int err   = avcodec_send_packet(codecContext_, packet);
+
+		if (err == AVERROR(EAGAIN))
+		{
+			// the decoder wants its output to be read first, drain it and resend the packet
+			auto recvExp = receiveFrames(frames, 0);
+			if (!recvExp)
+				FORWARD_AV_ERROR(recvExp);
+
+			count = std::get<1>(recvExp.value());
+			err   = avcodec_send_packet(codecContext_, packet);
+		}
+
+		if (err == AVERROR_EOF)
+			return std::tuple{Result::kEOF, count};
+
+		if (err < 0)
+			RETURN_AV_ERROR("Decoder error: {}", avErrorStr(err));
+
+		return receiveFrames(frames, count);
+	}
+
+	Expected<std::tuple<Result, int>> receiveFrames(std::vector<Frame>& frames, int offset) noexcept
+	{
+		for (int i = offset;; ++i)
+		{
+			if (i >= (int) frames.size())
+				frames.emplace_back();
+
+			int err = avcodec_receive_frame(codecContext_, *frames[i]);
+
+			if (err == AVERROR(EAGAIN))
+				return std::tuple{Result::kSuccess, i};
+
+			if (err == AVERROR_EOF)
+				return std::tuple{Result::kEOF, i};
+
+			if (err < 0)
+				RETURN_AV_ERROR("Decoder error: {}", avErrorStr(err));
+
+			frames[i].type(codecContext_->codec_type);
+		}
+	}
+
+	static void setThreading(AVCodecContext* codecContext, const DecoderThreading& threading) noexcept
+	{
+		// frame threading is known to misbehave with more than 16 threads
+		const int maxThreads = 16;
+
+		int count = threading.threadCount;
+		if (count <= 0)
+			count = std::clamp((int) std::thread::hardware_concurrency(), 1, maxThreads);
+
+		codecContext->thread_count = count;
+
+		switch (threading.type)
+		{
+			case DecoderThreadType::kFrame: codecContext->thread_type = FF_THREAD_FRAME; break;
+			case DecoderThreadType::kSlice: codecContext->thread_type = FF_THREAD_SLICE; break;
+			default: codecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE; break;
+		}
+	}
+
 private:
 	AVCodecContext* codecContext_{nullptr};
 };
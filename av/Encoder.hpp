@@ -163,11 +163,11 @@ public:
 		frame->pts    = 0;
 
 		/* allocate the buffers for the frame data */
-		auto ret = av_frame_get_buffer(frame, 0);
-		if (ret < 0)
-			RETURN_AV_ERROR("Could not allocate frame data: {}", avErrorStr(ret));
+		auto bufferExp = FramePool::instance().getBuffer(frame);
+		if (!bufferExp)
+			FORWARD_AV_ERROR(bufferExp);
 
-		ret = av_frame_make_writable(frame);
+		auto ret = av_frame_make_writable(frame);
 		if (ret < 0)
 			RETURN_AV_ERROR("Could not make frame writable: {}", avErrorStr(ret));
 
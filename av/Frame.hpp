@@ -1,5 +1,6 @@
 #pragma once
 
+#include <av/FramePool.hpp>
 #include <av/common.hpp>
 
 namespace av
@@ -27,9 +28,9 @@ public:
 		f->height = height;
 		f->format = pixFmt;
 
-		auto err = av_frame_get_buffer(f, align);
-		if(err < 0)
-			RETURN_AV_ERROR("Failed to get buffer: {}", avErrorStr(err));
+		auto bufferExp = FramePool::instance().getBuffer(f, align);
+		if (!bufferExp)
+			FORWARD_AV_ERROR(bufferExp);
 
 		return frame;
 	}
@@ -61,6 +62,7 @@ public:
 	Frame(Frame&& other) noexcept
 	{
 		frame_       = other.frame_;
+		type_        = other.type_;
 		other.frame_ = nullptr;
 	}
 
@@ -68,6 +70,7 @@ public:
 	{
 		frame_ = av_frame_alloc();
 		av_frame_ref(frame_, *other);
+		type_ = other.type_;
 	}
 
 	Frame& operator=(Frame&& other) noexcept
@@ -77,6 +80,7 @@ public:
 
 		av_frame_free(&frame_);
 		frame_       = other.frame_;
+		type_        = other.type_;
 		other.frame_ = nullptr;
 
 		return *this;
@@ -89,10 +93,24 @@ public:
 
 		av_frame_unref(frame_);
 		av_frame_ref(frame_, *other);
+		type_ = other.type_;
 
 		return *this;
 	}
 
+	// Takes over the data references of other leaving it blank but reusable
+	void moveRef(Frame& other) noexcept
+	{
+		av_frame_unref(frame_);
+		av_frame_move_ref(frame_, *other);
+		type_ = other.type_;
+	}
+
+	void dataUnref() noexcept
+	{
+		av_frame_unref(frame_);
+	}
+
 	AVMediaType type() const noexcept
 	{
 		return type_;
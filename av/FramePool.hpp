@@ -0,0 +1,177 @@
+#pragma once
+
+#include <av/common.hpp>
+
+#include <algorithm>
+#include <mutex>
+
+extern "C"
+{
+#include <libavutil/pixdesc.h>
+}
+
+namespace av
+{
+
+// Process wide pools of video frame buffers keyed by (width, height, format, alignment). Buffers of released
+// frames return to their pool instead of being freed, so pipelines allocating frames of the same geometry
+// over and over do no large allocations in the steady state. Only pools of the few most recently requested geometries
+// are kept, so a process going through many resolutions doesn't hold free buffers of every one it has seen.
+// Safe to use from any thread.
+class FramePool : NoCopyable
+{
+	struct Key
+	{
+		int width;
+		int height;
+		int format;
+		int align;
+
+		bool operator==(const Key& other) const noexcept
+		{
+			return width == other.width && height == other.height && format == other.format && align == other.align;
+		}
+	};
+
+	// Layout of all planes in a single pooled buffer
+	struct Pool : NoCopyable
+	{
+		~Pool()
+		{
+			// buffers still in use are freed when they are released
+			av_buffer_pool_uninit(&pool);
+		}
+
+		AVBufferPool* pool{nullptr};
+		int linesize[4]{};
+		size_t offset[4]{};
+		int planes{0};
+	};
+
+	static constexpr int kDefaultAlign = 64;
+	// geometries in use at the same time, e.g. decoded, scaled and encoded frames of a few streams
+	static constexpr size_t kMaxPools = 8;
+
+	FramePool() = default;
+
+public:
+	static FramePool& instance() noexcept
+	{
+		static FramePool pool;
+		return pool;
+	}
+
+	// Same as av_frame_get_buffer for video frames: width, height and format must be set on the frame.
+	// align - linesize alignment, 0 - suitable for SIMD of the current CPU
+	[[nodiscard]] Expected<void> getBuffer(AVFrame* frame, int align = 0) noexcept
+	{
+		if (frame->width <= 0 || frame->height <= 0 || frame->format < 0)
+			RETURN_AV_ERROR("Frame geometry or format is not set: {}x{} format {}", frame->width, frame->height, frame->format);
+
+		if (frame->buf[0])
+			RETURN_AV_ERROR("Frame already has buffers");
+
+		if (align <= 0)
+			align = kDefaultAlign;
+
+		auto poolExp = findPool({frame->width, frame->height, frame->format, align});
+		if (!poolExp)
+			FORWARD_AV_ERROR(poolExp);
+
+		auto pool = poolExp.value();
+
+		frame->buf[0] = av_buffer_pool_get(pool->pool);
+		if (!frame->buf[0])
+			RETURN_AV_ERROR("Failed to get buffer from the frame pool");
+
+		// the buffer is allocated with extra align bytes
+		auto* base = (uint8_t*) FFALIGN((uintptr_t) frame->buf[0]->data, (uintptr_t) align);
+
+		for (int i = 0; i < pool->planes; ++i)
+		{
+			frame->data[i]     = base + pool->offset[i];
+			frame->linesize[i] = pool->linesize[i];
+		}
+
+		frame->extended_data = frame->data;
+
+		return {};
+	}
+
+	// Releases pools of all geometries, buffers in use are freed when their frames are released
+	void clear() noexcept
+	{
+		std::lock_guard lock(mutex_);
+		pools_.clear();
+	}
+
+private:
+	Expected<Ptr<Pool>> findPool(const Key& key) noexcept
+	{
+		std::lock_guard lock(mutex_);
+
+		auto it = std::find_if(pools_.begin(), pools_.end(), [&](const auto& p) { return p.first == key; });
+		if (it != pools_.end())
+		{
+			// the most recently used pool is the last one
+			std::rotate(it, it + 1, pools_.end());
+			return pools_.back().second;
+		}
+
+		auto poolExp = createPool(key);
+		if (!poolExp)
+			FORWARD_AV_ERROR(poolExp);
+
+		// drops the least recently used geometry: its free buffers are freed now, the ones in use when their frames are released
+		if (pools_.size() >= kMaxPools)
+			pools_.erase(pools_.begin());
+
+		pools_.emplace_back(key, poolExp.value());
+
+		return poolExp;
+	}
+
+	// Mirrors the plane layout of av_frame_get_buffer
+	static Expected<Ptr<Pool>> createPool(const Key& key) noexcept
+	{
+		const auto format = (AVPixelFormat) key.format;
+		const auto* desc  = av_pix_fmt_desc_get(format);
+		if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+			RETURN_AV_ERROR("Frame pool doesn't support pixel format {}", key.format);
+
+		auto pool = makePtr<Pool>();
+
+		auto err = av_image_fill_linesizes(pool->linesize, format, FFALIGN(key.width, key.align));
+		if (err < 0)
+			RETURN_AV_ERROR("Failed to get linesizes: {}", avErrorStr(err));
+
+		for (auto& linesize : pool->linesize)
+			linesize = FFALIGN(linesize, key.align);
+
+		// some simd code reads past the last line, like in av_frame_get_buffer
+		const int paddedHeight = FFALIGN(key.height, 32);
+
+		uint8_t* data[4] = {};
+		const int size   = av_image_fill_pointers(data, format, paddedHeight, nullptr, pool->linesize);
+		if (size < 0)
+			RETURN_AV_ERROR("Failed to get frame size: {}", avErrorStr(size));
+
+		for (int i = 0; i < 4 && (data[i] || i == 0); ++i)
+		{
+			pool->offset[i] = (size_t) (data[i] - data[0]);
+			pool->planes    = i + 1;
+		}
+
+		pool->pool = av_buffer_pool_init(size + 16 + key.align - 1, nullptr);
+		if (!pool->pool)
+			RETURN_AV_ERROR("Failed to create buffer pool of {} bytes", size);
+
+		return pool;
+	}
+
+private:
+	std::mutex mutex_;
+	std::vector<std::pair<Key, Ptr<Pool>>> pools_;
+};
+
+}// namespace av
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <av/MappedFile.hpp>
+#include <av/common.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <span>
+
+namespace av
+{
+
+// Custom AVIOContext backed by user callbacks or memory instead of an ffmpeg protocol, either for reading or writing.
+// It must outlive the format context which uses it.
+class IOContext : NoCopyable
+{
+public:
+	// Returns the number of bytes read, 0 at the end of data or a negative AVERROR code
+	using ReadCallback = std::function<int(uint8_t* buf, int size)>;
+	// Same semantics as lseek, whence may also be AVSEEK_SIZE to query the total size (or return a negative value)
+	using SeekCallback = std::function<int64_t(int64_t offset, int whence)>;
+	// Returns the number of bytes written or a negative AVERROR code
+	using WriteCallback = std::function<int(const uint8_t* buf, int size)>;
+
+private:
+	IOContext() = default;
+
+public:
+	static constexpr int kDefaultBufferSize  = 64 * 1024;
+	static constexpr size_t kMappedReadAhead = 4 * 1024 * 1024;
+
+	// If seek is empty the input is non-seekable
+	static Expected<Ptr<IOContext>> create(ReadCallback read, SeekCallback seek = {}, int bufferSize = kDefaultBufferSize) noexcept
+	{
+		if (!read)
+			RETURN_AV_ERROR("Read callback is not set");
+
+		Ptr<IOContext> io{new IOContext};
+		io->read_ = std::move(read);
+		io->seek_ = std::move(seek);
+
+		auto allocExp = io->alloc(bufferSize, false);
+		if (!allocExp)
+			FORWARD_AV_ERROR(allocExp);
+
+		return io;
+	}
+
+	// Output sink, if seek is empty the output is non-seekable and muxers must not seek back (e.g. fragmented mp4)
+	static Expected<Ptr<IOContext>> createWriter(WriteCallback write, SeekCallback seek = {}, int bufferSize = kDefaultBufferSize) noexcept
+	{
+		if (!write)
+			RETURN_AV_ERROR("Write callback is not set");
+
+		Ptr<IOContext> io{new IOContext};
+		io->write_ = std::move(write);
+		io->seek_  = std::move(seek);
+
+		auto allocExp = io->alloc(bufferSize, true);
+		if (!allocExp)
+			FORWARD_AV_ERROR(allocExp);
+
+		return io;
+	}
+
+	// Output sink collecting muxed bytes in the growable buffer owned by the caller
+	static Expected<Ptr<IOContext>> createMemoryWriter(Ptr<std::vector<uint8_t>> out, bool seekable = true, int bufferSize = kDefaultBufferSize) noexcept
+	{
+		if (!out)
+			RETURN_AV_ERROR("Output buffer is null");
+
+		struct Cursor
+		{
+			Ptr<std::vector<uint8_t>> out;
+			int64_t pos{0};
+		};
+
+		auto cursor = makePtr<Cursor>();
+		cursor->out = std::move(out);
+		cursor->pos = (int64_t) cursor->out->size();
+
+		auto write = [cursor](const uint8_t* buf, int size) {
+			auto& out = *cursor->out;
+			if (cursor->pos + size > (int64_t) out.size())
+				out.resize(cursor->pos + size);
+
+			std::memcpy(out.data() + cursor->pos, buf, size);
+			cursor->pos += size;
+
+			return size;
+		};
+
+		SeekCallback seek;
+		if (seekable)
+		{
+			seek = [cursor](int64_t offset, int whence) -> int64_t {
+				const auto size = (int64_t) cursor->out->size();
+
+				switch (whence)
+				{
+					case AVSEEK_SIZE: return size;
+					case SEEK_SET: break;
+					case SEEK_CUR: offset += cursor->pos; break;
+					case SEEK_END: offset += size; break;
+					default: return AVERROR(EINVAL);
+				}
+
+				// seeking past the end is allowed, the gap is zero filled on the next write
+				if (offset < 0)
+					return AVERROR(EINVAL);
+
+				cursor->pos = offset;
+				return offset;
+			};
+		}
+
+		return createWriter(std::move(write), std::move(seek), bufferSize);
+	}
+
+	// Reads directly from caller memory without storing the data to a file first,
+	// the memory must stay valid while the context is in use
+	static Expected<Ptr<IOContext>> create(std::span<const uint8_t> data, int bufferSize = kDefaultBufferSize) noexcept
+	{
+		return createMemory(data, nullptr, bufferSize);
+	}
+
+	// Serves reads from a memory mapping of the local file instead of the file protocol. It saves the read syscalls
+	// and the kernel copy, the data is still copied from the mapping into the io buffer of avformat.
+	// The path is kept as sourcePath() and used as the stream info cache key of inputs opened through the context
+	static Expected<Ptr<IOContext>> createMapped(std::string_view path, int bufferSize = kDefaultBufferSize) noexcept
+	{
+		auto fileExp = MappedFile::open(path, MADV_SEQUENTIAL);
+		if (!fileExp)
+			FORWARD_AV_ERROR(fileExp);
+
+		auto file = fileExp.value();
+		file->willNeed(0, kMappedReadAhead);
+
+		auto ioExp = createMemory(file->data(), file, bufferSize);
+		if (!ioExp)
+			FORWARD_AV_ERROR(ioExp);
+
+		ioExp.value()->sourcePath_ = path;
+
+		return ioExp;
+	}
+
+	~IOContext()
+	{
+		if (ctx_)
+		{
+			av_freep(&ctx_->buffer);
+			avio_context_free(&ctx_);
+		}
+	}
+
+	auto* operator*() noexcept
+	{
+		return ctx_;
+	}
+	const auto* operator*() const noexcept
+	{
+		return ctx_;
+	}
+
+	// Path of the mapped file, empty for other contexts
+	const std::string& sourcePath() const noexcept
+	{
+		return sourcePath_;
+	}
+
+	auto* native() noexcept
+	{
+		return ctx_;
+	}
+	const auto* native() const noexcept
+	{
+		return ctx_;
+	}
+
+private:
+	// file - mapping the data belongs to, kept alive by the context
+	static Expected<Ptr<IOContext>> createMemory(std::span<const uint8_t> data, Ptr<MappedFile> file, int bufferSize) noexcept
+	{
+		struct Cursor
+		{
+			std::span<const uint8_t> data;
+			Ptr<MappedFile> file;
+			int64_t pos{0};
+		};
+
+		auto cursor  = makePtr<Cursor>();
+		cursor->data = data;
+		cursor->file = std::move(file);
+
+		auto read = [cursor](uint8_t* buf, int size) {
+			const auto left = (int64_t) cursor->data.size() - cursor->pos;
+			const int n     = (int) std::min<int64_t>(left, size);
+			if (n <= 0)
+				return 0;
+
+			std::memcpy(buf, cursor->data.data() + cursor->pos, n);
+			cursor->pos += n;
+
+			return n;
+		};
+
+		auto seek = [cursor](int64_t offset, int whence) -> int64_t {
+			const auto size = (int64_t) cursor->data.size();
+
+			switch (whence)
+			{
+				case AVSEEK_SIZE: return size;
+				case SEEK_SET: break;
+				case SEEK_CUR: offset += cursor->pos; break;
+				case SEEK_END: offset += size; break;
+				default: return AVERROR(EINVAL);
+			}
+
+			if (offset < 0 || offset > size)
+				return AVERROR(EINVAL);
+
+			cursor->pos = offset;
+
+			if (cursor->file)
+				cursor->file->willNeed(offset, kMappedReadAhead);
+
+			return offset;
+		};
+
+		return create(std::move(read), std::move(seek), bufferSize);
+	}
+
+	Expected<void> alloc(int bufferSize, bool writable) noexcept
+	{
+		if (bufferSize <= 0)
+			RETURN_AV_ERROR("Invalid io buffer size: {}", bufferSize);
+
+		auto buffer = (uint8_t*) av_malloc(bufferSize);
+		if (!buffer)
+			RETURN_AV_ERROR("Failed to allocate io buffer of {} bytes", bufferSize);
+
+		ctx_ = avio_alloc_context(buffer, bufferSize, writable ? 1 : 0, this,
+		                          writable ? nullptr : &IOContext::readPacket,
+		                          writable ? &IOContext::writePacket : nullptr,
+		                          seek_ ? &IOContext::seekPacket : nullptr);
+		if (!ctx_)
+		{
+			av_free(buffer);
+			RETURN_AV_ERROR("Failed to allocate io context");
+		}
+
+		return {};
+	}
+
+	static int readPacket(void* opaque, uint8_t* buf, int size) noexcept
+	{
+		auto n = static_cast<IOContext*>(opaque)->read_(buf, size);
+		return n == 0 ? AVERROR_EOF : n;
+	}
+
+	static int writePacket(void* opaque, uint8_t* buf, int size) noexcept
+	{
+		return static_cast<IOContext*>(opaque)->write_(buf, size);
+	}
+
+	static int64_t seekPacket(void* opaque, int64_t offset, int whence) noexcept
+	{
+		return static_cast<IOContext*>(opaque)->seek_(offset, whence & ~AVSEEK_FORCE);
+	}
+
+private:
+	AVIOContext* ctx_{nullptr};
+	ReadCallback read_;
+	WriteCallback write_;
+	SeekCallback seek_;
+	std::string sourcePath_;
+};
+
+}// namespace av
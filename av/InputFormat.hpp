@@ -1,12 +1,26 @@
 #pragma once
 
 #include <av/Decoder.hpp>
+#include <av/IOContext.hpp>
 #include <av/Packet.hpp>
+#include <av/StreamInfoCache.hpp>
 #include <av/common.hpp>
 
 namespace av
 {
 
+struct StreamSelection
+{
+	// Indices of streams to decode, -1 picks the best stream of the type
+	int videoIndex{-1};
+	int audioIndex{-1};
+	// Streams which are not selected are discarded by the demuxer and never returned by readFrame
+	bool discardOthers{true};
+	// false - streams are selected for reading packets only (e.g. remuxing): decoders are not opened
+	// and streams of codecs without a decoder in the build are accepted
+	bool openDecoders{true};
+};
+
 class SimpleInputFormat : NoCopyable
 {
 	explicit SimpleInputFormat(AVFormatContext* ic) noexcept
@@ -14,43 +28,25 @@ class SimpleInputFormat : NoCopyable
 	{}
 
 public:
-	static Expected<Ptr<SimpleInputFormat>> create(std::string_view url, bool enableAudio = false) noexcept
+	static Expected<Ptr<SimpleInputFormat>> create(std::string_view url, bool enableAudio = false, const DecoderThreading& threading = {}, const ProbeParams& probe = {},
+	                                               const StreamSelection& selection = {}) noexcept
 	{
-		AVFormatContext* ic = nullptr;
-		auto err            = avformat_open_input(&ic, url.data(), nullptr, nullptr);
-		if (err < 0)
-			RETURN_AV_ERROR("Cannot open input '{}': {}", url, avErrorStr(err));
-
-		err = avformat_find_stream_info(ic, nullptr);
-		if (err < 0)
-		{
-			avformat_close_input(&ic);
-			RETURN_AV_ERROR("Cannot find stream info: {}", avErrorStr(err));
-		}
-
-		Ptr<SimpleInputFormat> res{new SimpleInputFormat{ic}};
-		res->url_ = url;
-
-		{
-			auto ret = res->findBestStream(AVMEDIA_TYPE_VIDEO);
-			if (!ret)
-				FORWARD_AV_ERROR(ret);
-		}
-
-		if (enableAudio)
-		{
-			auto ret = res->findBestStream(AVMEDIA_TYPE_AUDIO);
-			if (!ret)
-				FORWARD_AV_ERROR(ret);
-		}
+		return open(url, nullptr, enableAudio, threading, probe, selection);
+	}
 
-		av_dump_format(ic, 0, nullptr, 0);
+	// Reads the input through the custom io context, e.g. from memory, instead of opening an url
+	static Expected<Ptr<SimpleInputFormat>> create(Ptr<IOContext> io, bool enableAudio = false, const DecoderThreading& threading = {}, const ProbeParams& probe = {},
+	                                               const StreamSelection& selection = {}) noexcept
+	{
+		if (!io)
+			RETURN_AV_ERROR("IO context is null");
 
-		return res;
+		return open("<custom io>", std::move(io), enableAudio, threading, probe, selection);
 	}
 
 	~SimpleInputFormat()
 	{
+		// closing the format context doesn't touch custom io, io_ is released after it
 		avformat_close_input(&ic_);
 	}
 
@@ -80,6 +76,70 @@ public:
 		}
 	}
 
+	// Controls whether the demuxer reads and parses packets of the stream, AVDISCARD_ALL drops the stream completely
+	[[nodiscard]] Expected<void> setDiscard(int streamIndex, AVDiscard discard) noexcept
+	{
+		if (streamIndex < 0 || streamIndex >= (int) ic_->nb_streams)
+			RETURN_AV_ERROR("Stream index '{}' is out of range [{}-{}]", streamIndex, 0, (int) ic_->nb_streams - 1);
+
+		ic_->streams[streamIndex]->discard = discard;
+
+		return {};
+	}
+
+	void discardUnselectedStreams() noexcept
+	{
+		for (unsigned i = 0; i < ic_->nb_streams; ++i)
+		{
+			auto* st = ic_->streams[i];
+			if (st != std::get<0>(vStream_) && st != std::get<0>(aStream_))
+				st->discard = AVDISCARD_ALL;
+		}
+	}
+
+	int streamCount() const noexcept
+	{
+		return (int) ic_->nb_streams;
+	}
+
+	// Seeks to the keyframe at or before the timestamp given in the stream time base
+	[[nodiscard]] Expected<void> seek(int streamIndex, int64_t timestamp) noexcept
+	{
+		auto err = av_seek_frame(ic_, streamIndex, timestamp, AVSEEK_FLAG_BACKWARD);
+		if (err < 0)
+			RETURN_AV_ERROR("Failed to seek to {} in '{}': {}", timestamp, url_, avErrorStr(err));
+
+		return {};
+	}
+
+	[[nodiscard]] Expected<void> seekByte(int64_t pos) noexcept
+	{
+		auto err = av_seek_frame(ic_, -1, pos, AVSEEK_FLAG_BYTE);
+		if (err < 0)
+			RETURN_AV_ERROR("Failed to seek to byte {} in '{}': {}", pos, url_, avErrorStr(err));
+
+		return {};
+	}
+
+	bool canSeekByte() const noexcept
+	{
+		return !(ic_->iformat->flags & AVFMT_NO_BYTE_SEEK);
+	}
+
+	auto* native() noexcept
+	{
+		return ic_;
+	}
+	const auto* native() const noexcept
+	{
+		return ic_;
+	}
+
+	const auto& url() const noexcept
+	{
+		return url_;
+	}
+
 	auto& videoStream() noexcept
 	{
 		return vStream_;
@@ -90,19 +150,75 @@ public:
 	}
 
 private:
-	Expected<void> findBestStream(AVMediaType type) noexcept
+	static Expected<Ptr<SimpleInputFormat>> open(std::string_view url, Ptr<IOContext> io, bool enableAudio, const DecoderThreading& threading, const ProbeParams& probe,
+	                                             const StreamSelection& selection) noexcept
+	{
+		// a mapped file is identified by its path like a plain url
+		auto probeParams = probe;
+		if (io && probeParams.cacheKey.empty())
+			probeParams.cacheKey = StreamInfoCache::sourceKey(io->sourcePath());
+
+		auto icExp = StreamInfoCache::instance().openInput(url, probeParams, io ? io->native() : nullptr);
+		if (!icExp)
+			FORWARD_AV_ERROR(icExp);
+
+		AVFormatContext* ic = icExp.value();
+
+		Ptr<SimpleInputFormat> res{new SimpleInputFormat{ic}};
+		res->url_          = url;
+		res->io_           = std::move(io);
+		res->threading_    = threading;
+		res->openDecoders_ = selection.openDecoders;
+
+		{
+			auto ret = res->findBestStream(AVMEDIA_TYPE_VIDEO, selection.videoIndex);
+			if (!ret)
+				FORWARD_AV_ERROR(ret);
+		}
+
+		if (enableAudio)
+		{
+			auto ret = res->findBestStream(AVMEDIA_TYPE_AUDIO, selection.audioIndex);
+			if (!ret)
+				FORWARD_AV_ERROR(ret);
+		}
+
+		if (selection.discardOthers)
+			res->discardUnselectedStreams();
+
+		av_dump_format(ic, 0, nullptr, 0);
+
+		return res;
+	}
+
+	Expected<void> findBestStream(AVMediaType type, int wantedIndex = -1) noexcept
 	{
 		AVCodec* dec = nullptr;
-		int stream_i = av_find_best_stream(ic_, type, -1, -1, &dec, 0);
+		// without the decoder argument the stream is chosen regardless of decoder availability
+		int stream_i = av_find_best_stream(ic_, type, wantedIndex, -1, openDecoders_ ? &dec : nullptr, 0);
 		if (stream_i == AVERROR_STREAM_NOT_FOUND)
 			RETURN_AV_ERROR("Failed to find {} stream in '{}'", av_get_media_type_string(type), url_);
 		if (stream_i == AVERROR_DECODER_NOT_FOUND)
-			RETURN_AV_ERROR("Failed to find decoder '{}' of '{}'", avcodec_get_name(ic_->streams[stream_i]->codecpar->codec_id), url_);
+			RETURN_AV_ERROR("Failed to find decoder of {} stream in '{}'", av_get_media_type_string(type), url_);
+		if (stream_i < 0)
+			RETURN_AV_ERROR("Failed to find {} stream in '{}': {}", av_get_media_type_string(type), url_, avErrorStr(stream_i));
+
+		if (!openDecoders_)
+		{
+			if (type == AVMEDIA_TYPE_VIDEO)
+				std::get<0>(vStream_) = ic_->streams[stream_i];
+			else if (type == AVMEDIA_TYPE_AUDIO)
+				std::get<0>(aStream_) = ic_->streams[stream_i];
+			else
+				RETURN_AV_ERROR("Not supported stream type '{}'", av_get_media_type_string(type));
+
+			return {};
+		}
 
 		if (type == AVMEDIA_TYPE_VIDEO)
 		{
 			const auto framerate = av_guess_frame_rate(ic_, ic_->streams[stream_i], nullptr);
-			auto decContext      = Decoder::create(dec, ic_->streams[stream_i], framerate);
+			auto decContext      = Decoder::create(dec, ic_->streams[stream_i], framerate, threading_);
 
 			if (!decContext)
 				FORWARD_AV_ERROR(decContext);
@@ -112,7 +228,7 @@ private:
 		}
 		else if (type == AVMEDIA_TYPE_AUDIO)
 		{
-			auto decContext = Decoder::create(dec, ic_->streams[stream_i]);
+			auto decContext = Decoder::create(dec, ic_->streams[stream_i], {}, threading_);
 
 			if (!decContext)
 				FORWARD_AV_ERROR(decContext);
@@ -128,6 +244,9 @@ private:
 
 private:
 	std::string url_;
+	Ptr<IOContext> io_;
+	DecoderThreading threading_;
+	bool openDecoders_{true};
 	AVFormatContext* ic_{nullptr};
 	std::tuple<AVStream*, Ptr<Decoder>> vStream_;
 	std::tuple<AVStream*, Ptr<Decoder>> aStream_;
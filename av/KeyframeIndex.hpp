@@ -0,0 +1,307 @@
+#pragma once
+
+#include <av/MappedFile.hpp>
+#include <av/Packet.hpp>
+#include <av/common.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <span>
+
+namespace av
+{
+
+// Packet index of a video stream built in a single demux pass without decoding.
+// Sidecar file layout (native endianness): Header, keyframes sorted by pts, all packets in demux order.
+// The file is memory-mapped on load, so opening an index of a multi-hour recording costs nothing.
+// The header keeps size and modification time of the indexed file, a sidecar of a replaced or appended
+// recording is detected and rebuilt by loadOrBuild.
+class KeyframeIndex : NoCopyable
+{
+public:
+	struct Entry
+	{
+		int64_t pts;
+		int64_t dts;
+		int64_t pos;
+		int32_t flags;
+		int32_t reserved;
+	};
+
+private:
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		int32_t streamIndex;
+		int32_t timeBaseNum;
+		int32_t timeBaseDen;
+		uint32_t reserved;
+		uint64_t keyframeCount;
+		uint64_t packetCount;
+		// of the indexed file, 0 if it isn't a local file
+		uint64_t sourceSize;
+		int64_t sourceMtime;
+		// in AV_TIME_BASE units
+		int64_t duration;
+	};
+
+	static constexpr char kMagic[4]     = {'A', 'V', 'K', 'I'};
+	static constexpr uint32_t kVersion = 2;
+
+	KeyframeIndex() = default;
+
+public:
+	static Expected<Ptr<KeyframeIndex>> build(std::string_view url) noexcept
+	{
+		// taken before reading, so a file growing during the pass doesn't match the index afterwards
+		const auto source = fileVersion(url);
+
+		AVFormatContext* ic = nullptr;
+		auto err            = avformat_open_input(&ic, url.data(), nullptr, nullptr);
+		if (err < 0)
+			RETURN_AV_ERROR("Cannot open input '{}': {}", url, avErrorStr(err));
+
+		err = avformat_find_stream_info(ic, nullptr);
+		if (err < 0)
+		{
+			avformat_close_input(&ic);
+			RETURN_AV_ERROR("Cannot find stream info: {}", avErrorStr(err));
+		}
+
+		int streamIndex = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+		if (streamIndex < 0)
+		{
+			avformat_close_input(&ic);
+			RETURN_AV_ERROR("Failed to find video stream in '{}'", url);
+		}
+
+		// don't spend time on parsing packets of other streams
+		for (unsigned i = 0; i < ic->nb_streams; ++i)
+		{
+			if ((int) i != streamIndex)
+				ic->streams[i]->discard = AVDISCARD_ALL;
+		}
+
+		Ptr<KeyframeIndex> index{new KeyframeIndex};
+		index->streamIndex_ = streamIndex;
+		index->timeBase_    = ic->streams[streamIndex]->time_base;
+		index->source_      = source;
+		index->duration_    = ic->duration;
+
+		Packet packet;
+		for (;;)
+		{
+			packet.dataUnref();
+			err = av_read_frame(ic, *packet);
+
+			if (err == AVERROR(EAGAIN))
+				continue;
+
+			if (err == AVERROR_EOF)
+				break;
+
+			if (err < 0)
+			{
+				avformat_close_input(&ic);
+				RETURN_AV_ERROR("Failed to read frame: {}", avErrorStr(err));
+			}
+
+			const auto* p = packet.native();
+			if (p->stream_index != streamIndex)
+				continue;
+
+			index->packetStorage_.push_back(Entry{p->pts, p->dts, p->pos, p->flags, 0});
+		}
+
+		avformat_close_input(&ic);
+
+		for (const auto& e : index->packetStorage_)
+		{
+			if (e.flags & AV_PKT_FLAG_KEY)
+				index->keyframeStorage_.push_back(e);
+		}
+
+		std::stable_sort(index->keyframeStorage_.begin(), index->keyframeStorage_.end(),
+		                 [](const Entry& l, const Entry& r) { return timestamp(l) < timestamp(r); });
+
+		index->packets_   = index->packetStorage_;
+		index->keyframes_ = index->keyframeStorage_;
+
+		return index;
+	}
+
+	static Expected<Ptr<KeyframeIndex>> load(std::string_view path) noexcept
+	{
+		auto fileExp = MappedFile::open(path, MADV_RANDOM);
+		if (!fileExp)
+			FORWARD_AV_ERROR(fileExp);
+
+		const auto data = fileExp.value()->data();
+		const auto size = data.size();
+
+		if (size < sizeof(Header))
+			RETURN_AV_ERROR("Index file '{}' is truncated", path);
+
+		Ptr<KeyframeIndex> index{new KeyframeIndex};
+		index->file_ = fileExp.value();
+
+		const auto* header = reinterpret_cast<const Header*>(data.data());
+		if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion)
+			RETURN_AV_ERROR("'{}' is not a keyframe index file or its version is not supported", path);
+
+		const auto maxEntries = size / sizeof(Entry);
+		if (header->keyframeCount > maxEntries || header->packetCount > maxEntries
+		    || sizeof(Header) + (header->keyframeCount + header->packetCount) * sizeof(Entry) != size)
+			RETURN_AV_ERROR("Index file '{}' is corrupted", path);
+
+		const auto* entries = reinterpret_cast<const Entry*>(data.data() + sizeof(Header));
+
+		index->streamIndex_ = header->streamIndex;
+		index->timeBase_    = {header->timeBaseNum, header->timeBaseDen};
+		index->keyframes_   = {entries, header->keyframeCount};
+		index->packets_     = {entries + header->keyframeCount, header->packetCount};
+		index->source_      = {header->sourceSize, header->sourceMtime};
+		index->duration_    = header->duration;
+
+		return index;
+	}
+
+	// Loads the sidecar index of the url or builds and saves it if there is none yet or the url has changed since
+	static Expected<Ptr<KeyframeIndex>> loadOrBuild(std::string_view url) noexcept
+	{
+		const auto path = sidecarPath(url);
+
+		if (access(path.c_str(), R_OK) == 0)
+		{
+			auto indexExp = load(path);
+			if (indexExp && indexExp.value()->matchesSource(url))
+				return indexExp;
+
+			if (indexExp)
+				LOG_AV_INFO("Rebuilding keyframe index: '{}' has changed since it was indexed", url);
+			else
+				LOG_AV_INFO("Rebuilding keyframe index: {}", indexExp.errorString());
+		}
+
+		auto indexExp = build(url);
+		if (!indexExp)
+			FORWARD_AV_ERROR(indexExp);
+
+		auto saveExp = indexExp.value()->save(path);
+		if (!saveExp)
+			LOG_AV_ERROR(saveExp.errorString());
+
+		return indexExp;
+	}
+
+	static std::string sidecarPath(std::string_view url) noexcept
+	{
+		return std::string(url) + ".avki";
+	}
+
+	[[nodiscard]] Expected<void> save(std::string_view path) const noexcept
+	{
+		// write to a temporary file first so readers never map a partially written index
+		const std::string tmpPath = std::string(path) + ".tmp";
+
+		FILE* f = std::fopen(tmpPath.c_str(), "wb");
+		if (!f)
+			RETURN_AV_ERROR("Failed to create index file '{}': {}", tmpPath, std::strerror(errno));
+
+		Header header{};
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version       = kVersion;
+		header.streamIndex   = streamIndex_;
+		header.timeBaseNum   = timeBase_.num;
+		header.timeBaseDen   = timeBase_.den;
+		header.keyframeCount = keyframes_.size();
+		header.packetCount   = packets_.size();
+		header.sourceSize    = source_.size;
+		header.sourceMtime   = source_.mtime;
+		header.duration      = duration_;
+
+		bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+		ok      = ok && std::fwrite(keyframes_.data(), sizeof(Entry), keyframes_.size(), f) == keyframes_.size();
+		ok      = ok && std::fwrite(packets_.data(), sizeof(Entry), packets_.size(), f) == packets_.size();
+		ok      = (std::fclose(f) == 0) && ok;
+
+		if (!ok || std::rename(tmpPath.c_str(), std::string(path).c_str()) != 0)
+		{
+			std::remove(tmpPath.c_str());
+			RETURN_AV_ERROR("Failed to write index file '{}'", path);
+		}
+
+		return {};
+	}
+
+	// False if the url is a local file of another size or modification time than the indexed one.
+	// Indexes of other urls can't be checked and always match
+	bool matchesSource(std::string_view url) const noexcept
+	{
+		const auto current = fileVersion(url);
+		if (!current.size && !source_.size)
+			return true;
+
+		return current == source_;
+	}
+
+	// Returns the last keyframe at or before the timestamp (in stream time base) or the first keyframe
+	[[nodiscard]] const Entry* findKeyframe(int64_t ts) const noexcept
+	{
+		if (keyframes_.empty())
+			return nullptr;
+
+		auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), ts,
+		                           [](int64_t v, const Entry& e) { return v < timestamp(e); });
+
+		if (it != keyframes_.begin())
+			--it;
+
+		return &*it;
+	}
+
+	static int64_t timestamp(const Entry& e) noexcept
+	{
+		return e.pts != AV_NOPTS_VALUE ? e.pts : e.dts;
+	}
+
+	int streamIndex() const noexcept
+	{
+		return streamIndex_;
+	}
+
+	AVRational timeBase() const noexcept
+	{
+		return timeBase_;
+	}
+
+	// Duration of the indexed input in AV_TIME_BASE units, AV_NOPTS_VALUE if unknown
+	int64_t duration() const noexcept
+	{
+		return duration_;
+	}
+
+	std::span<const Entry> keyframes() const noexcept
+	{
+		return keyframes_;
+	}
+
+	std::span<const Entry> packets() const noexcept
+	{
+		return packets_;
+	}
+
+private:
+	int streamIndex_{-1};
+	AVRational timeBase_{};
+	FileVersion source_;
+	int64_t duration_{AV_NOPTS_VALUE};
+	std::span<const Entry> keyframes_;
+	std::span<const Entry> packets_;
+	std::vector<Entry> keyframeStorage_;
+	std::vector<Entry> packetStorage_;
+	Ptr<MappedFile> file_;
+};
+
+}// namespace av
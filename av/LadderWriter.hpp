@@ -0,0 +1,130 @@
+#pragma once
+
+#include <av/StreamWriter.hpp>
+#include <av/common.hpp>
+
+namespace av
+{
+
+struct Rendition
+{
+	// output file, the container format is guessed from its name
+	std::string filename;
+	std::variant<AVCodecID, std::string> codec;
+	int width{0};
+	int height{0};
+	OptValueMap codecParams;
+};
+
+struct LadderParams
+{
+	// Keyframe interval of all renditions in AV_TIME_BASE units, 0 - keyframes are chosen by every encoder.
+	// Encoders shouldn't insert keyframes on their own (e.g. scene cuts) to keep renditions aligned
+	int64_t keyframeInterval{2 * AV_TIME_BASE};
+	PipelineParams pipeline;
+};
+
+// Encodes the same input into several renditions (an ABR ladder) in parallel. Every frame is decoded once
+// and handed by reference to the pipelined writer of each rendition, which scales and encodes it on its own thread
+// and muxes into its own output. Keyframes are forced on the same frames in all renditions.
+class LadderWriter : NoCopyable
+{
+	LadderWriter() = default;
+
+public:
+	// timeBase - time base of the input frames, e.g. {1, 25} for 25 fps
+	[[nodiscard]] static Expected<Ptr<LadderWriter>> create(int inWidth, int inHeight, AVPixelFormat inPixFmt, AVRational timeBase,
+	                                                        const std::vector<Rendition>& renditions, const LadderParams& params = {}) noexcept
+	{
+		if (renditions.empty())
+			RETURN_AV_ERROR("No renditions");
+
+		Ptr<LadderWriter> ladder{new LadderWriter};
+		ladder->timeBase_ = timeBase;
+		ladder->params_   = params;
+
+		for (const auto& r : renditions)
+		{
+			auto swExp = StreamWriter::create(r.filename);
+			if (!swExp)
+				FORWARD_AV_ERROR(swExp);
+
+			auto sw = swExp.value();
+
+			std::variant<AVCodecID, std::string_view> codec;
+			if (std::holds_alternative<AVCodecID>(r.codec))
+				codec = std::get<AVCodecID>(r.codec);
+			else
+				codec = std::get<std::string>(r.codec);
+
+			auto codecParams = r.codecParams;
+
+			auto indexExp = sw->addVideoStream(codec, inWidth, inHeight, inPixFmt, timeBase, r.width, r.height, std::move(codecParams));
+			if (!indexExp)
+				FORWARD_AV_ERROR(indexExp);
+
+			auto openExp = sw->open();
+			if (!openExp)
+				FORWARD_AV_ERROR(openExp);
+
+			auto pipelineExp = sw->startPipeline(params.pipeline);
+			if (!pipelineExp)
+				FORWARD_AV_ERROR(pipelineExp);
+
+			ladder->writers_.emplace_back(std::move(sw));
+		}
+
+		return ladder;
+	}
+
+	~LadderWriter()
+	{
+		flush();
+	}
+
+	// Queues the frame to all renditions, blocks only if some of them is behind by the whole queue depth.
+	// The frame data must not be modified afterwards unless it is made writable
+	[[nodiscard]] Expected<void> write(Frame& frame) noexcept
+	{
+		const auto time     = av_rescale_q(frameCount_++, timeBase_, AV_TIME_BASE_Q);
+		const bool keyframe = params_.keyframeInterval > 0 && time >= nextKeyframeTime_;
+
+		if (keyframe)
+			nextKeyframeTime_ = (time / params_.keyframeInterval + 1) * params_.keyframeInterval;
+
+		for (auto& sw : writers_)
+		{
+			auto writeExp = sw->write(frame, 0, keyframe);
+			if (!writeExp)
+				FORWARD_AV_ERROR(writeExp);
+		}
+
+		return {};
+	}
+
+	// Waits until all renditions are encoded and muxed
+	void flush() noexcept
+	{
+		for (auto& sw : writers_)
+			sw->flushAllStreams();
+	}
+
+	size_t size() const noexcept
+	{
+		return writers_.size();
+	}
+
+	StreamWriter& writer(size_t index) noexcept
+	{
+		return *writers_[index];
+	}
+
+private:
+	AVRational timeBase_{};
+	LadderParams params_;
+	std::vector<Ptr<StreamWriter>> writers_;
+	int64_t frameCount_{0};
+	int64_t nextKeyframeTime_{0};
+};
+
+}// namespace av
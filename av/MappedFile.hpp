@@ -0,0 +1,123 @@
+#pragma once
+
+#include <av/common.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <span>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace av
+{
+
+// Identifies the content of a local file by its size and modification time, e.g. to notice a file replaced at the same path
+struct FileVersion
+{
+	uint64_t size{0};
+	// nanoseconds
+	int64_t mtime{0};
+
+	bool operator==(const FileVersion& other) const noexcept = default;
+};
+
+// Version of a local file url, with or without the "file:" prefix. Zeros if the url isn't a regular file
+inline FileVersion fileVersion(std::string_view url) noexcept
+{
+	if (url.starts_with("file:"))
+		url.remove_prefix(5);
+
+	struct stat st = {};
+	if (stat(std::string(url).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+		return {};
+
+	return {(uint64_t) st.st_size, (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec};
+}
+
+// Read-only memory mapping of a whole file. Mappings of the same file in different processes
+// share the page cache, reading from them doesn't involve read() syscalls and copies into user buffers.
+class MappedFile : NoCopyable
+{
+	MappedFile() = default;
+
+public:
+	// advice - madvise hint for the whole mapping, e.g. MADV_SEQUENTIAL or MADV_RANDOM
+	static Expected<Ptr<MappedFile>> open(std::string_view path, int advice = MADV_NORMAL) noexcept
+	{
+		std::string p(path);
+
+		int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			RETURN_AV_ERROR("Failed to open '{}': {}", path, std::strerror(errno));
+
+		struct stat st = {};
+		if (fstat(fd, &st) < 0)
+		{
+			auto err = errno;
+			::close(fd);
+			RETURN_AV_ERROR("Failed to stat '{}': {}", path, std::strerror(err));
+		}
+
+		Ptr<MappedFile> file{new MappedFile};
+		file->size_ = (size_t) st.st_size;
+
+		// mmap of zero length fails, an empty file is just an empty span
+		if (file->size_ == 0)
+		{
+			::close(fd);
+			return file;
+		}
+
+		void* data = mmap(nullptr, file->size_, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+
+		if (data == MAP_FAILED)
+			RETURN_AV_ERROR("Failed to map '{}': {}", path, std::strerror(errno));
+
+		file->data_ = static_cast<uint8_t*>(data);
+
+		if (advice != MADV_NORMAL)
+			madvise(file->data_, file->size_, advice);
+
+		return file;
+	}
+
+	~MappedFile()
+	{
+		if (data_)
+			munmap(data_, size_);
+	}
+
+	// Asks the kernel to read the range ahead
+	void willNeed(size_t offset, size_t length) noexcept
+	{
+		if (!data_ || offset >= size_)
+			return;
+
+		static const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+
+		const size_t begin = offset & ~(pageSize - 1);
+		const size_t end   = std::min(size_, offset + length);
+
+		madvise(data_ + begin, end - begin, MADV_WILLNEED);
+	}
+
+	std::span<const uint8_t> data() const noexcept
+	{
+		return {data_, size_};
+	}
+
+	size_t size() const noexcept
+	{
+		return size_;
+	}
+
+private:
+	uint8_t* data_{nullptr};
+	size_t size_{0};
+};
+
+}// namespace av
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <av/Encoder.hpp>
+#include <av/IOContext.hpp>
+#include <av/OptSetter.hpp>
 #include <av/common.hpp>
 
 namespace av
@@ -16,7 +18,7 @@ public:
 	static Expected<Ptr<OutputFormat>> create(std::string_view filename, std::string_view formatName = {}) noexcept
 	{
 		AVFormatContext* oc = nullptr;
-		int err             = avformat_alloc_output_context2(&oc, nullptr, formatName.empty() ? nullptr : formatName.data(), filename.data());
+		int err             = avformat_alloc_output_context2(&oc, nullptr, formatName.empty() ? nullptr : formatName.data(), filename.empty() ? nullptr : filename.data());
 		if (!oc || err < 0)
 			RETURN_AV_ERROR("Failed to create output format context: {}", avErrorStr(err));
 
@@ -25,19 +27,12 @@ public:
 
 	~OutputFormat()
 	{
-		if (oc_)
-		{
-			if (oc_->pb)
-			{
-				auto err = av_write_trailer(oc_);
-				if (err < 0)
-					LOG_AV_ERROR("Failed to write format trailer: {}", avErrorStr(err));
-
-				avio_close(oc_->pb);
-			}
+		auto closeExp = close();
+		if (!closeExp)
+			LOG_AV_ERROR(closeExp.errorString());
 
+		if (oc_)
 			avformat_free_context(oc_);
-		}
 	}
 
 	auto* operator*() noexcept
@@ -58,6 +53,13 @@ public:
 		return oc_;
 	}
 
+	// Sets private options of the muxer, e.g. {"movflags", "frag_keyframe+empty_moov"}, should be called before open()
+	void setMuxerOptions(const OptValueMap& valueMap) noexcept
+	{
+		if (oc_->priv_data)
+			OptSetter::set(oc_->priv_data, valueMap);
+	}
+
 	// should be called before open()
 	[[nodiscard]] Expected<int> addStream(Ptr<Encoder>& codecContext) noexcept
 	{
@@ -77,7 +79,30 @@ public:
 		if (oc_->oformat->flags & AVFMT_GLOBALHEADER)
 			codecContext->native()->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
-		streams_.emplace_back(std::tuple{stream, codecContext});
+		streams_.emplace_back(std::tuple{stream, codecContext, codecContext->native()->time_base});
+
+		int ind = (int) streams_.size() - 1;
+		return ind;
+	}
+
+	// Adds a stream which is written from already encoded packets, e.g. copied from an input without re-encoding.
+	// timeBase - time base of the packets passed to writePacket(). Should be called before open()
+	[[nodiscard]] Expected<int> addStream(const AVCodecParameters* par, AVRational timeBase) noexcept
+	{
+		auto stream = avformat_new_stream(oc_, nullptr);
+		if (!stream)
+			RETURN_AV_ERROR("Failed to create new stream");
+
+		auto ret = avcodec_parameters_copy(stream->codecpar, par);
+		if (ret < 0)
+			RETURN_AV_ERROR("Could not copy the stream parameters: {}", avErrorStr(ret));
+
+		// the codec tag of the input container may be invalid in the output one, let the muxer choose it
+		stream->codecpar->codec_tag = 0;
+		stream->id                  = (int) oc_->nb_streams - 1;
+		stream->time_base           = timeBase;
+
+		streams_.emplace_back(std::tuple{stream, Ptr<Encoder>{}, timeBase});
 
 		int ind = (int) streams_.size() - 1;
 		return ind;
@@ -92,14 +117,23 @@ public:
 		if (err < 0)
 			RETURN_AV_ERROR("Failed to open io context for '{}': {}", filename, err);
 
-		AVDictionary* opts = nullptr;
-		err                = avformat_write_header(oc_, &opts);
-		if (err < 0)
-			RETURN_AV_ERROR("Failed to write header: {}", avErrorStr(err));
+		return writeHeader();
+	}
 
-		av_dump_format(oc_, 0, nullptr, 1);
+	// Writes muxed data to the custom io context, e.g. a memory buffer or a user callback, instead of a file
+	[[nodiscard]] Expected<void> open(Ptr<IOContext> io) noexcept
+	{
+		if (!io)
+			RETURN_AV_ERROR("IO context is null");
 
-		return {};
+		if (oc_->pb)
+			RETURN_AV_ERROR("Output is already opened");
+
+		io_        = std::move(io);
+		oc_->pb    = io_->native();
+		oc_->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+		return writeHeader();
 	}
 
 	[[nodiscard]] Expected<void> writePacket(Packet& packet, int streamIndex) noexcept
@@ -109,10 +143,10 @@ public:
 		if (!expectedStream)
 			FORWARD_AV_ERROR(expectedStream);
 
-		auto [stream, codecContext] = expectedStream.value();
+		auto [stream, codecContext, timeBase] = expectedStream.value();
 
 		/* rescale output packet timestamp values from codec to stream timebase */
-		av_packet_rescale_ts(*packet, codecContext->native()->time_base, stream->time_base);
+		av_packet_rescale_ts(*packet, timeBase, stream->time_base);
 		packet.native()->stream_index = stream->index;
 		packet.native()->pos          = -1;
 
@@ -123,8 +157,49 @@ public:
 		return {};
 	}
 
+	// Writes the trailer and closes the output, called by the destructor if it wasn't called before
+	[[nodiscard]] Expected<void> close() noexcept
+	{
+		if (!oc_ || !oc_->pb)
+			return {};
+
+		auto err = av_write_trailer(oc_);
+
+		avio_flush(oc_->pb);
+		bytesWritten_ = avio_tell(oc_->pb);
+
+		// custom io is owned by io_
+		if (io_)
+			oc_->pb = nullptr;
+		else
+			avio_closep(&oc_->pb);
+
+		if (err < 0)
+			RETURN_AV_ERROR("Failed to write format trailer: {}", avErrorStr(err));
+
+		return {};
+	}
+
+	// Number of bytes muxed so far, including the trailer after close()
+	int64_t bytesWritten() const noexcept
+	{
+		return oc_->pb ? avio_tell(oc_->pb) : bytesWritten_;
+	}
+
 private:
-	[[nodiscard]] Expected<std::tuple<AVStream*, Ptr<Encoder>>> getStream(int index)
+	[[nodiscard]] Expected<void> writeHeader() noexcept
+	{
+		AVDictionary* opts = nullptr;
+		auto err           = avformat_write_header(oc_, &opts);
+		if (err < 0)
+			RETURN_AV_ERROR("Failed to write header: {}", avErrorStr(err));
+
+		av_dump_format(oc_, 0, nullptr, 1);
+
+		return {};
+	}
+
+	[[nodiscard]] Expected<std::tuple<AVStream*, Ptr<Encoder>, AVRational>> getStream(int index)
 	{
 		if (index < 0 || index >= (int)streams_.size())
 			RETURN_AV_ERROR("Stream index '{}' is out of range [{}-{}]", index, 0, streams_.size());
@@ -134,7 +209,10 @@ private:
 
 private:
 	AVFormatContext* oc_{nullptr};
-	std::vector<std::tuple<AVStream*, Ptr<Encoder>>> streams_;
+	Ptr<IOContext> io_;
+	// stream, encoder (null for copied streams), time base of written packets
+	std::vector<std::tuple<AVStream*, Ptr<Encoder>, AVRational>> streams_;
+	int64_t bytesWritten_{0};
 };
 
 }// namespace av
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <av/PacketPool.hpp>
 #include <av/common.hpp>
 
 namespace av
@@ -12,13 +13,13 @@ class Packet
 
 public:
 	Packet() noexcept
-	    : packet_(av_packet_alloc())
+	    : packet_(PacketPool::instance().acquire())
 	{
 	}
 
 	static Expected<Ptr<Packet>> create() noexcept
 	{
-		auto packet = av_packet_alloc();
+		auto packet = PacketPool::instance().acquire();
 		if (!packet)
 			RETURN_AV_ERROR("Failed to alloc packet");
 
@@ -27,14 +28,14 @@ public:
 
 	static Expected<Ptr<Packet>> create(const std::vector<uint8_t>& data) noexcept
 	{
-		auto packet = av_packet_alloc();
+		auto packet = PacketPool::instance().acquire();
 		if (!packet)
 			RETURN_AV_ERROR("Failed to alloc packet");
 
 		auto buffer = (uint8_t*) av_malloc(data.size());
 		if (!buffer)
 		{
-			av_packet_free(&packet);
+			PacketPool::instance().release(packet);
 			RETURN_AV_ERROR("Failed to allocate buffer");
 		}
 
@@ -44,7 +45,7 @@ public:
 		if (err < 0)
 		{
 			av_free(buffer);
-			av_packet_free(&packet);
+			PacketPool::instance().release(packet);
 			RETURN_AV_ERROR("Failed to make packet from data: {}", avErrorStr(err));
 		}
 
@@ -53,8 +54,7 @@ public:
 
 	~Packet()
 	{
-		if (packet_)
-			av_packet_free(&packet_);
+		PacketPool::instance().release(packet_);
 	}
 
 	Packet(Packet&& other) noexcept
@@ -65,7 +65,7 @@ public:
 
 	Packet(const Packet& other) noexcept
 	{
-		packet_ = av_packet_alloc();
+		packet_ = PacketPool::instance().acquire();
 		av_packet_ref(packet_, *other);
 	}
 
@@ -74,7 +74,7 @@ public:
 		if (&other == this)
 			return *this;
 
-		av_packet_free(&packet_);
+		PacketPool::instance().release(packet_);
 		packet_       = other.packet_;
 		other.packet_ = nullptr;
 
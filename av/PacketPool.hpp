@@ -0,0 +1,135 @@
+#pragma once
+
+#include <av/common.hpp>
+
+#include <mutex>
+
+namespace av
+{
+
+// Process wide pool of AVPacket structures backing Packet objects. Every thread keeps a small cache of free
+// packets accessed without locks, caches are refilled from and drained to the shared list in batches, so packets
+// created on one thread and released on another (demux -> decode, encode -> mux hand-offs) are recycled as well.
+class PacketPool : NoCopyable
+{
+	// max free packets kept by a thread
+	static constexpr size_t kCacheSize = 64;
+	// packets moved between a thread cache and the shared list at once
+	static constexpr size_t kBatchSize = 32;
+	// free packets above this count are freed
+	static constexpr size_t kMaxShared = 4096;
+
+	struct Cache
+	{
+		Cache()
+		{
+			packets.reserve(kCacheSize + 1);
+		}
+
+		~Cache()
+		{
+			PacketPool::instance().drain(packets, 0);
+			cacheDestroyed() = true;
+		}
+
+		std::vector<AVPacket*> packets;
+	};
+
+	PacketPool()
+	{
+		shared_.reserve(kMaxShared);
+	}
+
+public:
+	// Never destroyed, packets may be released by static objects and threads finishing after exit()
+	static PacketPool& instance() noexcept
+	{
+		static auto* pool = new PacketPool;
+		return *pool;
+	}
+
+	// Returns a blank packet or null if allocation failed
+	AVPacket* acquire() noexcept
+	{
+		if (cacheDestroyed())
+			return av_packet_alloc();
+
+		auto& cache = threadCache();
+		if (cache.empty())
+			refill(cache);
+
+		if (cache.empty())
+			return av_packet_alloc();
+
+		auto* packet = cache.back();
+		cache.pop_back();
+
+		return packet;
+	}
+
+	void release(AVPacket* packet) noexcept
+	{
+		if (!packet)
+			return;
+
+		av_packet_unref(packet);
+
+		if (cacheDestroyed())
+		{
+			av_packet_free(&packet);
+			return;
+		}
+
+		auto& cache = threadCache();
+		cache.push_back(packet);
+
+		if (cache.size() > kCacheSize)
+			drain(cache, kCacheSize - kBatchSize);
+	}
+
+private:
+	static std::vector<AVPacket*>& threadCache() noexcept
+	{
+		thread_local Cache cache;
+		return cache.packets;
+	}
+
+	// trivially destructible, so it is valid during destruction of other thread locals
+	static bool& cacheDestroyed() noexcept
+	{
+		thread_local bool destroyed = false;
+		return destroyed;
+	}
+
+	void refill(std::vector<AVPacket*>& cache) noexcept
+	{
+		std::lock_guard lock(mutex_);
+
+		const size_t n = std::min(kBatchSize, shared_.size());
+		cache.insert(cache.end(), shared_.end() - n, shared_.end());
+		shared_.resize(shared_.size() - n);
+	}
+
+	// Moves packets of the cache above keep to the shared list
+	void drain(std::vector<AVPacket*>& cache, size_t keep) noexcept
+	{
+		std::lock_guard lock(mutex_);
+
+		while (cache.size() > keep)
+		{
+			auto* packet = cache.back();
+			cache.pop_back();
+
+			if (shared_.size() < kMaxShared)
+				shared_.push_back(packet);
+			else
+				av_packet_free(&packet);
+		}
+	}
+
+private:
+	std::mutex mutex_;
+	std::vector<AVPacket*> shared_;
+};
+
+}// namespace av
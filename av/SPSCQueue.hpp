@@ -0,0 +1,152 @@
+#pragma once
+
+#include <av/common.hpp>
+
+#include <atomic>
+#include <utility>
+
+namespace av
+{
+
+// Bounded lock-free single producer single consumer queue.
+// Elements are exchanged with std::swap, so objects owning ffmpeg allocations (Packet, Frame)
+// are recycled between producer and consumer instead of being reallocated on every hand-off.
+// Besides the number of elements the queue may be bounded by the total weight of elements (e.g. bytes),
+// a single element is always accepted by an empty queue regardless of its weight.
+// Several queues may share an external signal word to let one thread wait for any of them.
+template<typename T>
+class SPSCQueue : NoCopyable
+{
+	struct Slot
+	{
+		T value;
+		size_t weight{0};
+	};
+
+public:
+	explicit SPSCQueue(size_t capacity, size_t maxWeight = 0, std::atomic<uint32_t>* signal = nullptr) noexcept
+	    : slots_(capacity + 1), maxWeight_(maxWeight), signal_(signal ? signal : &ownSignal_)
+	{
+	}
+
+	bool tryPush(T& value, size_t weight = 0) noexcept
+	{
+		const auto tail = tail_.load(std::memory_order_relaxed);
+		const auto next = increment(tail);
+		const auto head = head_.load(std::memory_order_acquire);
+
+		if (next == head)
+			return false;
+
+		if (maxWeight_ && tail != head && weight_.load(std::memory_order_relaxed) + weight > maxWeight_)
+			return false;
+
+		std::swap(slots_[tail].value, value);
+		slots_[tail].weight = weight;
+		weight_.fetch_add(weight, std::memory_order_relaxed);
+
+		tail_.store(next, std::memory_order_release);
+		signal();
+
+		return true;
+	}
+
+	bool tryPop(T& value) noexcept
+	{
+		const auto head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+			return false;
+
+		std::swap(value, slots_[head].value);
+		weight_.fetch_sub(slots_[head].weight, std::memory_order_relaxed);
+
+		head_.store(increment(head), std::memory_order_release);
+		signal();
+
+		return true;
+	}
+
+	// Blocks while the queue is full, returns false if the queue is closed
+	bool push(T& value, size_t weight = 0) noexcept
+	{
+		for (;;)
+		{
+			const auto s = signal_->load(std::memory_order_acquire);
+
+			if (closed_.load(std::memory_order_acquire))
+				return false;
+
+			if (tryPush(value, weight))
+				return true;
+
+			signal_->wait(s, std::memory_order_acquire);
+		}
+	}
+
+	// Blocks while the queue is empty, returns false once the queue is closed and drained
+	bool pop(T& value) noexcept
+	{
+		for (;;)
+		{
+			const auto s = signal_->load(std::memory_order_acquire);
+
+			if (tryPop(value))
+				return true;
+
+			if (closed_.load(std::memory_order_acquire))
+				return tryPop(value);
+
+			signal_->wait(s, std::memory_order_acquire);
+		}
+	}
+
+	// Wakes up all blocked callers, no more elements are accepted
+	void close() noexcept
+	{
+		closed_.store(true, std::memory_order_release);
+		signal();
+	}
+
+	bool closed() const noexcept
+	{
+		return closed_.load(std::memory_order_acquire);
+	}
+
+	// Approximate when called concurrently with push/pop
+	size_t size() const noexcept
+	{
+		const auto head = head_.load(std::memory_order_acquire);
+		const auto tail = tail_.load(std::memory_order_acquire);
+
+		return tail >= head ? tail - head : slots_.size() - head + tail;
+	}
+
+	size_t capacity() const noexcept
+	{
+		return slots_.size() - 1;
+	}
+
+private:
+	size_t increment(size_t i) const noexcept
+	{
+		return i + 1 == slots_.size() ? 0 : i + 1;
+	}
+
+	void signal() noexcept
+	{
+		signal_->fetch_add(1, std::memory_order_release);
+		signal_->notify_all();
+	}
+
+private:
+	std::vector<Slot> slots_;
+	const size_t maxWeight_;
+	alignas(64) std::atomic<size_t> head_{0};
+	alignas(64) std::atomic<size_t> tail_{0};
+	alignas(64) std::atomic<size_t> weight_{0};
+	std::atomic<uint32_t> ownSignal_{0};
+	std::atomic<uint32_t>* signal_;
+	std::atomic<bool> closed_{false};
+};
+
+}// namespace av
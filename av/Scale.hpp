@@ -1,50 +1,293 @@
 #pragma once
 
 #include <av/Frame.hpp>
+#include <av/ScaleKernels.hpp>
+#include <av/ThreadPool.hpp>
 #include <av/common.hpp>
 
+#include <algorithm>
+
+extern "C"
+{
+#include <libavutil/pixdesc.h>
+}
+
 namespace av
 {
 
+struct ScaleParams
+{
+	// Number of threads scaling horizontal bands of the frame in parallel, 1 - scale on the calling thread.
+	// swscale conversions are threaded only if rows are not rescaled vertically (same height and vertical
+	// chroma subsampling of input and output), the SIMD kernels always are
+	int threads{1};
+	// Scaling algorithm (SWS_BICUBIC, SWS_BILINEAR, SWS_POINT, ...) and other SWS_* flags
+	int flags{SWS_BICUBIC};
+	// Use the built-in SIMD kernels for the conversions they support when the algorithm allows it,
+	// see YuvToRgbKernel. The result is close to but not exactly the same as of swscale
+	bool fastPaths{true};
+};
+
 class Scale : NoCopyable
 {
-	explicit Scale(SwsContext* sws) noexcept
-	    : sws_(sws)
+	// Horizontal band of the frame scaled by its own context, the same rows of input and output
+	struct Band
+	{
+		SwsContext* sws{nullptr};
+		int y{0};
+	};
+
+	// bands are not shorter than this to keep them worth a thread
+	static constexpr int kMinBandHeight = 16;
+
+	Scale(int outputWidth, int outputHeight, AVPixelFormat outputPixFmt, const ScaleParams& params) noexcept
+	    : params_(params),
+	      outputWidth_(outputWidth),
+	      outputHeight_(outputHeight),
+	      outputPixFmt_(outputPixFmt)
 	{}
 
 public:
-	static Expected<Ptr<Scale>> create(int inputWidth, int inputHeight, AVPixelFormat inputPixFmt, int outputWidth, int outputHeight, AVPixelFormat outputPixFmt) noexcept
+	static Expected<Ptr<Scale>> create(int inputWidth, int inputHeight, AVPixelFormat inputPixFmt, int outputWidth, int outputHeight, AVPixelFormat outputPixFmt,
+	                                   const ScaleParams& params = {}) noexcept
 	{
-		auto sws = sws_getContext(inputWidth, inputHeight, inputPixFmt,
-		                          outputWidth, outputHeight, outputPixFmt,
-		                          SWS_BICUBIC, nullptr, nullptr, nullptr);
+		Ptr<Scale> scale{new Scale{outputWidth, outputHeight, outputPixFmt, params}};
 
-		if (!sws)
-			RETURN_AV_ERROR("Failed to create sws context");
+		auto bindExp = scale->bind(inputWidth, inputHeight, inputPixFmt);
+		if (!bindExp)
+			FORWARD_AV_ERROR(bindExp);
 
-		return Ptr<Scale>{new Scale{sws}};
+		return scale;
 	}
 
 	~Scale()
 	{
+		releaseThreading();
+
 		if (sws_)
 			sws_freeContext(sws_);
 	}
 
+	// Switches to another input geometry keeping the output one, does nothing if it hasn't changed
+	[[nodiscard]] Expected<void> rebind(int inputWidth, int inputHeight, AVPixelFormat inputPixFmt) noexcept
+	{
+		if (sws_ && inputWidth == inputWidth_ && inputHeight == inputHeight_ && inputPixFmt == inputPixFmt_)
+			return {};
+
+		return bind(inputWidth, inputHeight, inputPixFmt);
+	}
+
 	void scale(const uint8_t* const srcSlice[],
 	           const int srcStride[], int srcSliceY, int srcSliceH,
 	           uint8_t* const dst[], const int dstStride[])
 	{
+		// kernels and bands need the whole frame, partial slices go through the single context
+		if (srcSliceY == 0 && srcSliceH == inputHeight_)
+		{
+			if (kernel_)
+			{
+				scaleKernel(srcSlice, srcStride, dst, dstStride);
+				return;
+			}
+
+			if (!bands_.empty())
+			{
+				scaleBands(srcSlice, srcStride, dst, dstStride);
+				return;
+			}
+		}
+
 		sws_scale(sws_, srcSlice, srcStride, srcSliceY, srcSliceH, dst, dstStride);
 	}
 
 	void scale(const Frame& src, Frame& dst)
 	{
-		sws_scale(sws_, src.native()->data, src.native()->linesize, 0, src.native()->height, dst.native()->data, dst.native()->linesize);
+		scale(src.native()->data, src.native()->linesize, 0, src.native()->height, dst.native()->data, dst.native()->linesize);
+	}
+
+	int threads() const noexcept
+	{
+		return pool_ ? pool_->size() : 1;
+	}
+
+	// Instruction set of the SIMD kernel used for whole frames, null if they are scaled by swscale
+	const char* fastPath() const noexcept
+	{
+		return kernel_ ? kernel_->name() : nullptr;
+	}
+
+private:
+	Expected<void> bind(int inputWidth, int inputHeight, AVPixelFormat inputPixFmt) noexcept
+	{
+		releaseThreading();
+
+		// frees the old context if the geometry differs
+		sws_ = sws_getCachedContext(sws_, inputWidth, inputHeight, inputPixFmt,
+		                            outputWidth_, outputHeight_, outputPixFmt_,
+		                            params_.flags, nullptr, nullptr, nullptr);
+
+		if (!sws_)
+			RETURN_AV_ERROR("Failed to create sws context {}x{} {} -> {}x{} {}", inputWidth, inputHeight, av_get_pix_fmt_name(inputPixFmt),
+			                outputWidth_, outputHeight_, av_get_pix_fmt_name(outputPixFmt_));
+
+		inputWidth_  = inputWidth;
+		inputHeight_ = inputHeight;
+		inputPixFmt_ = inputPixFmt;
+
+		if (params_.fastPaths)
+			kernel_ = YuvToRgbKernel::find(inputWidth, inputHeight, inputPixFmt, outputWidth_, outputHeight_, outputPixFmt_, params_.flags);
+
+		if (kernel_)
+		{
+			LOG_AV_DEBUG("Scaling {}x{} {} -> {}x{} {} with {} kernel", inputWidth, inputHeight, av_get_pix_fmt_name(inputPixFmt),
+			             outputWidth_, outputHeight_, av_get_pix_fmt_name(outputPixFmt_), kernel_->name());
+
+			// the kernel converts any range of rows, no per band contexts needed
+			const int count = std::min(params_.threads, outputHeight_ / kMinBandHeight);
+			if (count > 1)
+				pool_ = makePtr<ThreadPool>(count);
+		}
+		else if (params_.threads > 1)
+		{
+			auto bandsExp = createBands(inputWidth, inputHeight, inputPixFmt, outputWidth_, outputHeight_, outputPixFmt_, params_.flags, params_.threads);
+			if (!bandsExp)
+				FORWARD_AV_ERROR(bandsExp);
+		}
+
+		return {};
+	}
+
+	void releaseThreading() noexcept
+	{
+		// the pool threads may use the contexts until it is stopped
+		pool_.reset();
+
+		for (auto& band : bands_)
+			sws_freeContext(band.sws);
+
+		bands_.clear();
+		kernel_.reset();
+	}
+
+	// Splits the frame into bands on chroma row boundaries, every band is scaled as a separate image.
+	// The result matches the whole frame scaling only if the vertical filter doesn't reach rows of the neighbour
+	// bands, i.e. it is the identity: neither rows are rescaled nor chroma is resampled vertically
+	Expected<void> createBands(int inputWidth, int inputHeight, AVPixelFormat inputPixFmt, int outputWidth, int outputHeight, AVPixelFormat outputPixFmt, int flags, int threads) noexcept
+	{
+		const auto* srcDesc = av_pix_fmt_desc_get(inputPixFmt);
+		const auto* dstDesc = av_pix_fmt_desc_get(outputPixFmt);
+
+		// palette and bitstream formats can't be addressed by rows
+		const auto unsupported = AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL;
+		if (!srcDesc || !dstDesc || (srcDesc->flags & unsupported) || (dstDesc->flags & unsupported))
+		{
+			LOG_AV_INFO("Threaded scaling of {} -> {} is not supported, scaling on one thread", av_get_pix_fmt_name(inputPixFmt), av_get_pix_fmt_name(outputPixFmt));
+			return {};
+		}
+
+		if (inputHeight != outputHeight || srcDesc->log2_chroma_h != dstDesc->log2_chroma_h)
+		{
+			LOG_AV_INFO("Threaded scaling of {}x{} {} -> {}x{} {} rescales rows vertically, scaling on one thread", inputWidth, inputHeight, av_get_pix_fmt_name(inputPixFmt),
+			            outputWidth, outputHeight, av_get_pix_fmt_name(outputPixFmt));
+			return {};
+		}
+
+		chromaShift_ = srcDesc->log2_chroma_h;
+
+		const int step  = 1 << chromaShift_;
+		const int count = std::max(1, std::min(threads, outputHeight / kMinBandHeight));
+
+		if (count < 2)
+			return {};
+
+		std::vector<Band> bands;
+		for (int i = 0; i <= count; ++i)
+		{
+			const int y = i == count ? outputHeight : (int) ((int64_t) outputHeight * i / count) / step * step;
+
+			if (bands.empty() || y > bands.back().y)
+				bands.push_back(Band{nullptr, y});
+		}
+
+		// the last entry only marks the end of the frame
+		for (size_t i = 0; i + 1 < bands.size(); ++i)
+		{
+			const int height = bands[i + 1].y - bands[i].y;
+
+			bands[i].sws = sws_getContext(inputWidth, height, inputPixFmt,
+			                              outputWidth, height, outputPixFmt,
+			                              flags, nullptr, nullptr, nullptr);
+
+			if (!bands[i].sws)
+			{
+				for (auto& band : bands)
+					sws_freeContext(band.sws);
+
+				RETURN_AV_ERROR("Failed to create sws context of band {}x{} -> {}x{}", inputWidth, height, outputWidth, height);
+			}
+		}
+
+		bands_ = std::move(bands);
+		pool_  = makePtr<ThreadPool>((int) bands_.size() - 1);
+
+		return {};
+	}
+
+	void scaleKernel(const uint8_t* const src[], const int srcStride[], uint8_t* const dst[], const int dstStride[]) noexcept
+	{
+		const int height = kernel_->outputHeight();
+
+		if (!pool_)
+		{
+			kernel_->run(src, srcStride, dst[0], dstStride[0], 0, height);
+			return;
+		}
+
+		const int count = pool_->size();
+		pool_->run(count, [&](int i) {
+			kernel_->run(src, srcStride, dst[0], dstStride[0], height * i / count, height * (i + 1) / count);
+		});
+	}
+
+	void scaleBands(const uint8_t* const src[], const int srcStride[], uint8_t* const dst[], const int dstStride[]) noexcept
+	{
+		pool_->run((int) bands_.size() - 1, [&](int i) {
+			const auto& band = bands_[i];
+			const int height = bands_[i + 1].y - band.y;
+
+			const uint8_t* srcBand[4] = {};
+			uint8_t* dstBand[4]       = {};
+
+			for (int p = 0; p < 4; ++p)
+			{
+				// planes 1 and 2 are chroma, the others (luma, alpha, packed) have full height
+				const int row = (p == 1 || p == 2) ? band.y >> chromaShift_ : band.y;
+
+				if (src[p])
+					srcBand[p] = src[p] + (ptrdiff_t) row * srcStride[p];
+				if (dst[p])
+					dstBand[p] = dst[p] + (ptrdiff_t) row * dstStride[p];
+			}
+
+			sws_scale(band.sws, srcBand, srcStride, 0, height, dstBand, dstStride);
+		});
 	}
 
 private:
+	ScaleParams params_;
 	SwsContext* sws_{nullptr};
+	int inputWidth_{0};
+	int inputHeight_{0};
+	AVPixelFormat inputPixFmt_{AV_PIX_FMT_NONE};
+	int outputWidth_{0};
+	int outputHeight_{0};
+	AVPixelFormat outputPixFmt_{AV_PIX_FMT_NONE};
+	// threaded mode, the last band only marks the end of the frame
+	std::vector<Band> bands_;
+	std::optional<YuvToRgbKernel> kernel_;
+	Ptr<ThreadPool> pool_;
+	// vertical chroma subsampling of both input and output in threaded mode
+	int chromaShift_{0};
 };
 
 }// namespace av
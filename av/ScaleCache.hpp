@@ -0,0 +1,142 @@
+#pragma once
+
+#include <av/Frame.hpp>
+#include <av/Scale.hpp>
+#include <av/common.hpp>
+
+namespace av
+{
+
+// Scalers of one consumer keyed by (input geometry, output geometry, flags). Every frame is checked against
+// the key of the last used scaler, so a stream of constant geometry pays a few comparisons per frame, while
+// a mid-stream resolution or format change (camera reconfiguration, adaptive streams) switches to a cached
+// or a new scaler instead of scaling with a stale one. Not thread safe, like Scale itself.
+class ScaleCache : NoCopyable
+{
+	struct Key
+	{
+		int inputWidth{0};
+		int inputHeight{0};
+		AVPixelFormat inputPixFmt{AV_PIX_FMT_NONE};
+		int outputWidth{0};
+		int outputHeight{0};
+		AVPixelFormat outputPixFmt{AV_PIX_FMT_NONE};
+		int flags{0};
+
+		bool operator==(const Key& other) const noexcept = default;
+
+		bool sameOutput(const Key& other) const noexcept
+		{
+			return outputWidth == other.outputWidth && outputHeight == other.outputHeight && outputPixFmt == other.outputPixFmt && flags == other.flags;
+		}
+	};
+
+	// geometries a stream switches between, e.g. renditions of an adaptive stream
+	static constexpr size_t kMaxEntries = 8;
+
+public:
+	explicit ScaleCache(const ScaleParams& params = {}) noexcept
+	    : params_(params)
+	{}
+
+	// Applies to scalers created afterwards, the cached ones are kept
+	void setParams(const ScaleParams& params) noexcept
+	{
+		params_ = params;
+	}
+
+	const ScaleParams& params() const noexcept
+	{
+		return params_;
+	}
+
+	[[nodiscard]] Expected<Ptr<Scale>> get(int inputWidth, int inputHeight, AVPixelFormat inputPixFmt, int outputWidth, int outputHeight, AVPixelFormat outputPixFmt) noexcept
+	{
+		const Key key{inputWidth, inputHeight, inputPixFmt, outputWidth, outputHeight, outputPixFmt, params_.flags};
+
+		// steady state
+		if (!entries_.empty() && entries_.back().first == key)
+			return entries_.back().second;
+
+		auto it = std::find_if(entries_.begin(), entries_.end(), [&](const auto& e) { return e.first == key; });
+		if (it != entries_.end())
+		{
+			// the most recently used entry is the last one
+			std::rotate(it, it + 1, entries_.end());
+			return entries_.back().second;
+		}
+
+		LOG_AV_INFO("Scaling {}x{} {} -> {}x{} {}", inputWidth, inputHeight, av_get_pix_fmt_name(inputPixFmt), outputWidth, outputHeight, av_get_pix_fmt_name(outputPixFmt));
+
+		Ptr<Scale> scale;
+
+		// the least recently used scaler of the same output is rebound instead of creating one more
+		if (entries_.size() >= kMaxEntries)
+		{
+			auto evicted = std::move(entries_.front());
+			entries_.erase(entries_.begin());
+
+			if (evicted.first.sameOutput(key))
+			{
+				auto rebindExp = evicted.second->rebind(inputWidth, inputHeight, inputPixFmt);
+				if (!rebindExp)
+					FORWARD_AV_ERROR(rebindExp);
+
+				scale = evicted.second;
+			}
+		}
+
+		if (!scale)
+		{
+			auto scaleExp = Scale::create(inputWidth, inputHeight, inputPixFmt, outputWidth, outputHeight, outputPixFmt, params_);
+			if (!scaleExp)
+				FORWARD_AV_ERROR(scaleExp);
+
+			scale = scaleExp.value();
+		}
+
+		entries_.emplace_back(key, scale);
+
+		return scale;
+	}
+
+	// Scales the whole src frame into dst using the geometry and format of both frames
+	[[nodiscard]] Expected<void> scale(const Frame& src, Frame& dst) noexcept
+	{
+		const auto* s = src.native();
+		const auto* d = dst.native();
+
+		auto scaleExp = get(s->width, s->height, (AVPixelFormat) s->format, d->width, d->height, (AVPixelFormat) d->format);
+		if (!scaleExp)
+			FORWARD_AV_ERROR(scaleExp);
+
+		scaleExp.value()->scale(src, dst);
+
+		return {};
+	}
+
+	// Scales the whole src frame into caller owned planes, e.g. a cv::Mat or a mapped buffer of any stride
+	[[nodiscard]] Expected<void> scale(const Frame& src, uint8_t* const dst[], const int dstStride[], int dstWidth, int dstHeight, AVPixelFormat dstPixFmt) noexcept
+	{
+		const auto* s = src.native();
+
+		auto scaleExp = get(s->width, s->height, (AVPixelFormat) s->format, dstWidth, dstHeight, dstPixFmt);
+		if (!scaleExp)
+			FORWARD_AV_ERROR(scaleExp);
+
+		scaleExp.value()->scale(s->data, s->linesize, 0, s->height, dst, dstStride);
+
+		return {};
+	}
+
+	void clear() noexcept
+	{
+		entries_.clear();
+	}
+
+private:
+	ScaleParams params_;
+	std::vector<std::pair<Key, Ptr<Scale>>> entries_;
+};
+
+}// namespace av
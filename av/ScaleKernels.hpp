@@ -0,0 +1,556 @@
+#pragma once
+
+#include <av/common.hpp>
+
+#include <algorithm>
+#include <optional>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AV_SCALE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace av
+{
+
+namespace internal
+{
+
+// Row primitives of the YUV -> RGB kernels. Every function processes the whole row,
+// the SIMD versions handle the tail with the scalar ones, so both give identical results.
+struct ScaleKernelOps
+{
+	const char* name;
+	// dst[x] = average of the 2x2 block at (2x, 0) of rows r0, r1
+	void (*box2)(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int width);
+	// dst[x] = average of the 4x4 block at (4x, 0) of rows r[0..3]
+	void (*box4)(const uint8_t* const r[4], uint8_t* dst, int width);
+	// dst[x] = src[x / 2]
+	void (*upsample)(const uint8_t* src, uint8_t* dst, int width);
+	// splits count interleaved UV pairs
+	void (*deinterleave)(const uint8_t* src, uint8_t* u, uint8_t* v, int count);
+	// packed RGB24 or BGR24 from full resolution Y, U, V rows
+	void (*yuvToRgb)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, bool bgr);
+};
+
+// BT.601 limited range coefficients in Q8, the same as swscale uses by default
+constexpr int kYuvY  = 298;
+constexpr int kYuvRV = 409;
+constexpr int kYuvGU = 100;
+constexpr int kYuvGV = 208;
+constexpr int kYuvBU = 516;
+
+// round(a * c / 256) computed like _mm_mulhrs_epi16 on a << 7
+inline int mulQ8(int a, int c) noexcept
+{
+	return (a * 128 * c + 0x4000) >> 15;
+}
+
+inline void box2Scalar(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int x, int width) noexcept
+{
+	for (; x < width; ++x)
+		dst[x] = (uint8_t) ((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+}
+
+inline void box4Scalar(const uint8_t* const r[4], uint8_t* dst, int x, int width) noexcept
+{
+	for (; x < width; ++x)
+	{
+		int sum = 0;
+		for (int i = 0; i < 4; ++i)
+			sum += r[i][4 * x] + r[i][4 * x + 1] + r[i][4 * x + 2] + r[i][4 * x + 3];
+
+		dst[x] = (uint8_t) ((sum + 8) >> 4);
+	}
+}
+
+inline void upsampleScalar(const uint8_t* src, uint8_t* dst, int x, int width) noexcept
+{
+	for (; x < width; ++x)
+		dst[x] = src[x >> 1];
+}
+
+inline void deinterleaveScalar(const uint8_t* src, uint8_t* u, uint8_t* v, int x, int count) noexcept
+{
+	for (; x < count; ++x)
+	{
+		u[x] = src[2 * x];
+		v[x] = src[2 * x + 1];
+	}
+}
+
+inline void yuvToRgbScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int x, int width, bool bgr) noexcept
+{
+	const int ri = bgr ? 2 : 0;
+	const int bi = bgr ? 0 : 2;
+
+	for (; x < width; ++x)
+	{
+		const int yc = mulQ8(y[x] - 16, kYuvY);
+		const int uc = u[x] - 128;
+		const int vc = v[x] - 128;
+
+		uint8_t* p = dst + 3 * x;
+		p[ri]      = (uint8_t) std::clamp(yc + mulQ8(vc, kYuvRV), 0, 255);
+		p[1]       = (uint8_t) std::clamp(yc - mulQ8(uc, kYuvGU) - mulQ8(vc, kYuvGV), 0, 255);
+		p[bi]      = (uint8_t) std::clamp(yc + mulQ8(uc, kYuvBU), 0, 255);
+	}
+}
+
+#ifdef AV_SCALE_KERNELS_X86
+
+#define AV_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define AV_TARGET_AVX2 __attribute__((target("avx2")))
+
+// pshufb masks spreading 16 bytes of one channel over 48 bytes of packed pixels: [output vector][channel]
+struct RgbShuffle
+{
+	alignas(16) int8_t mask[3][3][16];
+};
+
+constexpr RgbShuffle makeRgbShuffle() noexcept
+{
+	RgbShuffle s{};
+	for (int o = 0; o < 3; ++o)
+		for (int c = 0; c < 3; ++c)
+			for (int j = 0; j < 16; ++j)
+			{
+				const int i     = o * 16 + j;
+				s.mask[o][c][j] = i % 3 == c ? (int8_t) (i / 3) : (int8_t) -128;
+			}
+
+	return s;
+}
+
+inline constexpr RgbShuffle kRgbShuffle = makeRgbShuffle();
+
+// always inlined, so AVX2 callers get it VEX encoded
+__attribute__((always_inline)) AV_TARGET_SSE41 inline void storeRgb48(uint8_t* dst, __m128i c0, __m128i c1, __m128i c2) noexcept
+{
+	for (int o = 0; o < 3; ++o)
+	{
+		const auto* m = kRgbShuffle.mask[o];
+		__m128i out   = _mm_shuffle_epi8(c0, _mm_load_si128((const __m128i*) m[0]));
+		out           = _mm_or_si128(out, _mm_shuffle_epi8(c1, _mm_load_si128((const __m128i*) m[1])));
+		out           = _mm_or_si128(out, _mm_shuffle_epi8(c2, _mm_load_si128((const __m128i*) m[2])));
+
+		_mm_storeu_si128((__m128i*) (dst + 16 * o), out);
+	}
+}
+
+AV_TARGET_SSE41 inline void box2Sse41(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int width) noexcept
+{
+	const __m128i ones = _mm_set1_epi8(1);
+	const __m128i two  = _mm_set1_epi16(2);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		const uint8_t* a = r0 + 2 * x;
+		const uint8_t* b = r1 + 2 * x;
+
+		__m128i s0 = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*) a), ones),
+		                           _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*) b), ones));
+		__m128i s1 = _mm_add_epi16(_mm_maddubs_epi16(_mm_loadu_si128((const __m128i*) (a + 16)), ones),
+		                           _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*) (b + 16)), ones));
+
+		s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+		s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+
+		_mm_storeu_si128((__m128i*) (dst + x), _mm_packus_epi16(s0, s1));
+	}
+
+	box2Scalar(r0, r1, dst, x, width);
+}
+
+AV_TARGET_SSE41 inline void box4Sse41(const uint8_t* const r[4], uint8_t* dst, int width) noexcept
+{
+	const __m128i ones   = _mm_set1_epi8(1);
+	const __m128i ones16 = _mm_set1_epi16(1);
+	const __m128i eight  = _mm_set1_epi16(8);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		// every 16 input bytes give 4 outputs
+		__m128i q[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			__m128i pairs = _mm_setzero_si128();
+			for (int i = 0; i < 4; ++i)
+				pairs = _mm_add_epi16(pairs, _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*) (r[i] + 4 * x + 16 * k)), ones));
+
+			q[k] = _mm_madd_epi16(pairs, ones16);
+		}
+
+		__m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(q[0], q[1]), eight), 4);
+		__m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(q[2], q[3]), eight), 4);
+
+		_mm_storeu_si128((__m128i*) (dst + x), _mm_packus_epi16(lo, hi));
+	}
+
+	box4Scalar(r, dst, x, width);
+}
+
+AV_TARGET_SSE41 inline void upsampleSse41(const uint8_t* src, uint8_t* dst, int width) noexcept
+{
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		const __m128i s = _mm_loadu_si128((const __m128i*) (src + x / 2));
+		_mm_storeu_si128((__m128i*) (dst + x), _mm_unpacklo_epi8(s, s));
+		_mm_storeu_si128((__m128i*) (dst + x + 16), _mm_unpackhi_epi8(s, s));
+	}
+
+	upsampleScalar(src, dst, x, width);
+}
+
+AV_TARGET_SSE41 inline void deinterleaveSse41(const uint8_t* src, uint8_t* u, uint8_t* v, int count) noexcept
+{
+	const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+	int x = 0;
+	for (; x + 16 <= count; x += 16)
+	{
+		const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (src + 2 * x)), split);
+		const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (src + 2 * x + 16)), split);
+
+		_mm_storeu_si128((__m128i*) (u + x), _mm_unpacklo_epi64(a, b));
+		_mm_storeu_si128((__m128i*) (v + x), _mm_unpackhi_epi64(a, b));
+	}
+
+	deinterleaveScalar(src, u, v, x, count);
+}
+
+AV_TARGET_SSE41 inline void yuvToRgbSse41(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, bool bgr) noexcept
+{
+	const __m128i c16  = _mm_set1_epi16(16);
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i cy   = _mm_set1_epi16(kYuvY);
+	const __m128i crv  = _mm_set1_epi16(kYuvRV);
+	const __m128i cgu  = _mm_set1_epi16(kYuvGU);
+	const __m128i cgv  = _mm_set1_epi16(kYuvGV);
+	const __m128i cbu  = _mm_set1_epi16(kYuvBU);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		const __m128i y8 = _mm_loadu_si128((const __m128i*) (y + x));
+		const __m128i u8 = _mm_loadu_si128((const __m128i*) (u + x));
+		const __m128i v8 = _mm_loadu_si128((const __m128i*) (v + x));
+
+		__m128i r[2], g[2], b[2];
+		for (int h = 0; h < 2; ++h)
+		{
+			const __m128i y16 = _mm_slli_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(h ? _mm_srli_si128(y8, 8) : y8), c16), 7);
+			const __m128i u16 = _mm_slli_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(h ? _mm_srli_si128(u8, 8) : u8), c128), 7);
+			const __m128i v16 = _mm_slli_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(h ? _mm_srli_si128(v8, 8) : v8), c128), 7);
+
+			const __m128i yc = _mm_mulhrs_epi16(y16, cy);
+			r[h]             = _mm_add_epi16(yc, _mm_mulhrs_epi16(v16, crv));
+			g[h]             = _mm_sub_epi16(_mm_sub_epi16(yc, _mm_mulhrs_epi16(u16, cgu)), _mm_mulhrs_epi16(v16, cgv));
+			b[h]             = _mm_add_epi16(yc, _mm_mulhrs_epi16(u16, cbu));
+		}
+
+		const __m128i r8 = _mm_packus_epi16(r[0], r[1]);
+		const __m128i g8 = _mm_packus_epi16(g[0], g[1]);
+		const __m128i b8 = _mm_packus_epi16(b[0], b[1]);
+
+		storeRgb48(dst + 3 * x, bgr ? b8 : r8, g8, bgr ? r8 : b8);
+	}
+
+	yuvToRgbScalar(y, u, v, dst, x, width, bgr);
+}
+
+AV_TARGET_AVX2 inline void box2Avx2(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int width) noexcept
+{
+	const __m256i ones = _mm256_set1_epi8(1);
+	const __m256i two  = _mm256_set1_epi16(2);
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		const uint8_t* a = r0 + 2 * x;
+		const uint8_t* b = r1 + 2 * x;
+
+		__m256i s0 = _mm256_add_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*) a), ones),
+		                              _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*) b), ones));
+		__m256i s1 = _mm256_add_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*) (a + 32)), ones),
+		                              _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*) (b + 32)), ones));
+
+		s0 = _mm256_srli_epi16(_mm256_add_epi16(s0, two), 2);
+		s1 = _mm256_srli_epi16(_mm256_add_epi16(s1, two), 2);
+
+		// packus works within 128 bit lanes
+		_mm256_storeu_si256((__m256i*) (dst + x), _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1), 0xD8));
+	}
+
+	box2Scalar(r0, r1, dst, x, width);
+}
+
+AV_TARGET_AVX2 inline void box4Avx2(const uint8_t* const r[4], uint8_t* dst, int width) noexcept
+{
+	const __m256i ones   = _mm256_set1_epi8(1);
+	const __m256i ones16 = _mm256_set1_epi16(1);
+	const __m256i eight  = _mm256_set1_epi16(8);
+	const __m256i order  = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		// every 32 input bytes give 8 outputs, 4 per lane
+		__m256i q[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			__m256i pairs = _mm256_setzero_si256();
+			for (int i = 0; i < 4; ++i)
+				pairs = _mm256_add_epi16(pairs, _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*) (r[i] + 4 * x + 32 * k)), ones));
+
+			q[k] = _mm256_madd_epi16(pairs, ones16);
+		}
+
+		__m256i lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_packs_epi32(q[0], q[1]), eight), 4);
+		__m256i hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_packs_epi32(q[2], q[3]), eight), 4);
+
+		// lanes hold outputs 0-3 8-11 16-19 24-27 | 4-7 12-15 20-23 28-31
+		_mm256_storeu_si256((__m256i*) (dst + x), _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order));
+	}
+
+	box4Scalar(r, dst, x, width);
+}
+
+AV_TARGET_AVX2 inline void yuvToRgbAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width, bool bgr) noexcept
+{
+	const __m256i c16  = _mm256_set1_epi16(16);
+	const __m256i c128 = _mm256_set1_epi16(128);
+	const __m256i cy   = _mm256_set1_epi16(kYuvY);
+	const __m256i crv  = _mm256_set1_epi16(kYuvRV);
+	const __m256i cgu  = _mm256_set1_epi16(kYuvGU);
+	const __m256i cgv  = _mm256_set1_epi16(kYuvGV);
+	const __m256i cbu  = _mm256_set1_epi16(kYuvBU);
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m256i r[2], g[2], b[2];
+		for (int h = 0; h < 2; ++h)
+		{
+			const int o = x + 16 * h;
+
+			const __m256i y16 = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (y + o))), c16), 7);
+			const __m256i u16 = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (u + o))), c128), 7);
+			const __m256i v16 = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (v + o))), c128), 7);
+
+			const __m256i yc = _mm256_mulhrs_epi16(y16, cy);
+			r[h]             = _mm256_add_epi16(yc, _mm256_mulhrs_epi16(v16, crv));
+			g[h]             = _mm256_sub_epi16(_mm256_sub_epi16(yc, _mm256_mulhrs_epi16(u16, cgu)), _mm256_mulhrs_epi16(v16, cgv));
+			b[h]             = _mm256_add_epi16(yc, _mm256_mulhrs_epi16(u16, cbu));
+		}
+
+		const __m256i r8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(r[0], r[1]), 0xD8);
+		const __m256i g8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(g[0], g[1]), 0xD8);
+		const __m256i b8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(b[0], b[1]), 0xD8);
+
+		const __m256i c0 = bgr ? b8 : r8;
+		const __m256i c2 = bgr ? r8 : b8;
+
+		storeRgb48(dst + 3 * x, _mm256_castsi256_si128(c0), _mm256_castsi256_si128(g8), _mm256_castsi256_si128(c2));
+		storeRgb48(dst + 3 * x + 48, _mm256_extracti128_si256(c0, 1), _mm256_extracti128_si256(g8, 1), _mm256_extracti128_si256(c2, 1));
+	}
+
+	yuvToRgbScalar(y, u, v, dst, x, width, bgr);
+}
+
+inline constexpr ScaleKernelOps kScaleKernelsSse41{"sse4.1", box2Sse41, box4Sse41, upsampleSse41, deinterleaveSse41, yuvToRgbSse41};
+// upsample and deinterleave are cheap chroma passes, 128 bit versions are enough
+inline constexpr ScaleKernelOps kScaleKernelsAvx2{"avx2", box2Avx2, box4Avx2, upsampleSse41, deinterleaveSse41, yuvToRgbAvx2};
+
+#undef AV_TARGET_SSE41
+#undef AV_TARGET_AVX2
+
+#endif
+
+// Best row primitives supported by the CPU, null if there are none
+inline const ScaleKernelOps* scaleKernelOps() noexcept
+{
+#ifdef AV_SCALE_KERNELS_X86
+	static const ScaleKernelOps* ops = []() -> const ScaleKernelOps* {
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+			return &kScaleKernelsAvx2;
+
+		if (__builtin_cpu_supports("sse4.1"))
+			return &kScaleKernelsSse41;
+
+		return nullptr;
+	}();
+
+	return ops;
+#else
+	return nullptr;
+#endif
+}
+
+}// namespace internal
+
+// SIMD conversion of YUV420P or NV12 to RGB24 or BGR24 at the same size or downscaled 2x or 4x,
+// the hot paths of analytics pipelines. Downscaling is a box filter and chroma is upsampled by replication,
+// so it's used only for the algorithms that don't promise better quality (point, area, bilinear).
+class YuvToRgbKernel
+{
+	YuvToRgbKernel() = default;
+
+public:
+	// Returns nothing if the conversion or the CPU isn't supported
+	static std::optional<YuvToRgbKernel> find(int inputWidth, int inputHeight, AVPixelFormat inputPixFmt,
+	                                          int outputWidth, int outputHeight, AVPixelFormat outputPixFmt, int flags) noexcept
+	{
+		const int precise = SWS_BICUBIC | SWS_X | SWS_BICUBLIN | SWS_GAUSS | SWS_SINC | SWS_LANCZOS | SWS_SPLINE | SWS_ACCURATE_RND | SWS_BITEXACT;
+		if (flags & precise)
+			return std::nullopt;
+
+		if (inputPixFmt != AV_PIX_FMT_YUV420P && inputPixFmt != AV_PIX_FMT_NV12)
+			return std::nullopt;
+
+		if (outputPixFmt != AV_PIX_FMT_RGB24 && outputPixFmt != AV_PIX_FMT_BGR24)
+			return std::nullopt;
+
+		if (outputWidth <= 0 || outputHeight <= 0 || inputWidth % 2 || inputHeight % 2)
+			return std::nullopt;
+
+		int factor = 0;
+		for (int f : {1, 2, 4})
+		{
+			if (outputWidth * f == inputWidth && outputHeight * f == inputHeight)
+				factor = f;
+		}
+
+		const auto* ops = internal::scaleKernelOps();
+		if (!factor || !ops)
+			return std::nullopt;
+
+		YuvToRgbKernel kernel;
+		kernel.ops_          = ops;
+		kernel.inputWidth_   = inputWidth;
+		kernel.outputWidth_  = outputWidth;
+		kernel.outputHeight_ = outputHeight;
+		kernel.factor_       = factor;
+		kernel.nv12_         = inputPixFmt == AV_PIX_FMT_NV12;
+		kernel.bgr_          = outputPixFmt == AV_PIX_FMT_BGR24;
+
+		return kernel;
+	}
+
+	// Converts output rows [y0, y1), may be called concurrently for disjoint ranges
+	void run(const uint8_t* const src[], const int srcStride[], uint8_t* dst, int dstStride, int y0, int y1) const noexcept
+	{
+		const int w  = outputWidth_;
+		const int cw = inputWidth_ / 2;
+
+		// full resolution Y, U, V of the output row and deinterleaved NV12 chroma rows
+		thread_local std::vector<uint8_t> scratch;
+		scratch.resize((size_t) 3 * w + 4 * cw);
+
+		uint8_t* yRow   = scratch.data();
+		uint8_t* uRow   = yRow + w;
+		uint8_t* vRow   = uRow + w;
+		uint8_t* uTmp[] = {vRow + w, vRow + w + cw};
+		uint8_t* vTmp[] = {vRow + w + 2 * cw, vRow + w + 3 * cw};
+
+		for (int y = y0; y < y1; ++y)
+		{
+			const uint8_t* yp = nullptr;
+			const uint8_t* up = uRow;
+			const uint8_t* vp = vRow;
+
+			const uint8_t* luma = src[0] + (ptrdiff_t) y * factor_ * srcStride[0];
+			if (factor_ == 1)
+			{
+				yp = luma;
+			}
+			else if (factor_ == 2)
+			{
+				ops_->box2(luma, luma + srcStride[0], yRow, w);
+				yp = yRow;
+			}
+			else
+			{
+				const uint8_t* rows[4] = {luma, luma + srcStride[0], luma + 2 * srcStride[0], luma + 3 * srcStride[0]};
+				ops_->box4(rows, yRow, w);
+				yp = yRow;
+			}
+
+			// first chroma row of the output row
+			const int cy = y * factor_ / 2;
+
+			if (!nv12_)
+			{
+				const uint8_t* u = src[1] + (ptrdiff_t) cy * srcStride[1];
+				const uint8_t* v = src[2] + (ptrdiff_t) cy * srcStride[2];
+
+				if (factor_ == 1)
+				{
+					ops_->upsample(u, uRow, w);
+					ops_->upsample(v, vRow, w);
+				}
+				else if (factor_ == 2)
+				{
+					up = u;
+					vp = v;
+				}
+				else
+				{
+					ops_->box2(u, u + srcStride[1], uRow, w);
+					ops_->box2(v, v + srcStride[2], vRow, w);
+				}
+			}
+			else
+			{
+				const uint8_t* uv = src[1] + (ptrdiff_t) cy * srcStride[1];
+
+				if (factor_ == 1)
+				{
+					ops_->deinterleave(uv, uTmp[0], vTmp[0], cw);
+					ops_->upsample(uTmp[0], uRow, w);
+					ops_->upsample(vTmp[0], vRow, w);
+				}
+				else if (factor_ == 2)
+				{
+					ops_->deinterleave(uv, uRow, vRow, w);
+				}
+				else
+				{
+					ops_->deinterleave(uv, uTmp[0], vTmp[0], cw);
+					ops_->deinterleave(uv + srcStride[1], uTmp[1], vTmp[1], cw);
+					ops_->box2(uTmp[0], uTmp[1], uRow, w);
+					ops_->box2(vTmp[0], vTmp[1], vRow, w);
+				}
+			}
+
+			ops_->yuvToRgb(yp, up, vp, dst + (ptrdiff_t) y * dstStride, w, bgr_);
+		}
+	}
+
+	int outputHeight() const noexcept
+	{
+		return outputHeight_;
+	}
+
+	// Instruction set of the selected primitives
+	const char* name() const noexcept
+	{
+		return ops_->name;
+	}
+
+private:
+	const internal::ScaleKernelOps* ops_{nullptr};
+	int inputWidth_{0};
+	int outputWidth_{0};
+	int outputHeight_{0};
+	int factor_{1};
+	bool nv12_{false};
+	bool bgr_{false};
+};
+
+}// namespace av
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <av/MappedFile.hpp>
+#include <av/common.hpp>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace av
+{
+
+struct ProbeParams
+{
+	// Max bytes read while probing stream info, 0 - ffmpeg default
+	int64_t probeSize{0};
+	// Max input duration analyzed while probing in AV_TIME_BASE units, 0 - ffmpeg default
+	int64_t analyzeDuration{0};
+	// Reuse stream parameters of previous opens of the same source instead of probing. After a cache hit the context
+	// has only what the demuxer reads from the header: ic->duration, start_time, bit_rate and stream durations
+	// are unset unless the header has them, as avformat_find_stream_info doesn't run
+	bool useCache{false};
+	// Cache key, StreamInfoCache::sourceKey(url) is used if empty. May be a content signature of sources sharing
+	// the same stream layout
+	std::string cacheKey;
+};
+
+// Process wide cache of probed stream parameters. Repeated opens of a known source force the cached
+// input format and restore codec parameters of streams, skipping avformat_find_stream_info completely.
+// If streams created by the demuxer don't match the cached ones, the input is probed as usual.
+// Only codec parameters the demuxer left unknown are filled in, the ones read from the header are kept.
+class StreamInfoCache : NoCopyable
+{
+	struct StreamInfo
+	{
+		Ptr<AVCodecParameters> par;
+		AVRational avgFrameRate{};
+		AVRational rFrameRate{};
+	};
+
+	struct Entry
+	{
+		std::string formatName;
+		std::vector<StreamInfo> streams;
+	};
+
+	StreamInfoCache() = default;
+
+public:
+	static StreamInfoCache& instance() noexcept
+	{
+		static StreamInfoCache cache;
+		return cache;
+	}
+
+	// Default cache key: the url, along with size and modification time for a local file,
+	// so a file replaced at the same path is probed again instead of opened with stale parameters
+	static std::string sourceKey(std::string_view url) noexcept
+	{
+		const auto version = fileVersion(url);
+		if (!version.size)
+			return std::string(url);
+
+		return internal::format("{}|{}|{}", url, version.size, version.mtime);
+	}
+
+	// pb - custom io context to read from, url is used only for logging in this case.
+	// Inputs with custom io are cached only if the cache key is set explicitly.
+	[[nodiscard]] Expected<AVFormatContext*> openInput(std::string_view url, const ProbeParams& probe = {}, AVIOContext* pb = nullptr) noexcept
+	{
+		const std::string key = probe.cacheKey.empty() ? sourceKey(url) : probe.cacheKey;
+		const bool useCache   = probe.useCache && (!pb || !probe.cacheKey.empty());
+
+		if (probe.useCache && !useCache)
+			LOG_AV_INFO("Stream info cache is bypassed for custom io input '{}', it needs ProbeParams::cacheKey", url);
+
+		Ptr<const Entry> cached    = useCache ? find(key) : nullptr;
+		AVInputFormat* inputFormat = cached ? av_find_input_format(cached->formatName.c_str()) : nullptr;
+
+		AVDictionary* opts = nullptr;
+		if (probe.probeSize > 0)
+			av_dict_set_int(&opts, "probesize", probe.probeSize, 0);
+		if (probe.analyzeDuration > 0)
+			av_dict_set_int(&opts, "analyzeduration", probe.analyzeDuration, 0);
+
+		AVFormatContext* ic = nullptr;
+		if (pb)
+		{
+			ic = avformat_alloc_context();
+			if (!ic)
+			{
+				av_dict_free(&opts);
+				RETURN_AV_ERROR("Failed to allocate format context");
+			}
+
+			ic->pb = pb;
+			ic->flags |= AVFMT_FLAG_CUSTOM_IO;
+		}
+
+		// the context is freed by avformat_open_input on failure
+		auto err = avformat_open_input(&ic, pb ? nullptr : url.data(), inputFormat, &opts);
+		av_dict_free(&opts);
+
+		if (err < 0)
+			RETURN_AV_ERROR("Cannot open input '{}': {}", url, avErrorStr(err));
+
+		if (cached && restore(*cached, ic))
+			return ic;
+
+		err = avformat_find_stream_info(ic, nullptr);
+		if (err < 0)
+		{
+			avformat_close_input(&ic);
+			RETURN_AV_ERROR("Cannot find stream info: {}", avErrorStr(err));
+		}
+
+		if (useCache)
+			store(key, ic);
+
+		return ic;
+	}
+
+	void erase(const std::string& key) noexcept
+	{
+		std::lock_guard lock(mutex_);
+		entries_.erase(key);
+	}
+
+	void clear() noexcept
+	{
+		std::lock_guard lock(mutex_);
+		entries_.clear();
+	}
+
+private:
+	Ptr<const Entry> find(const std::string& key) noexcept
+	{
+		std::lock_guard lock(mutex_);
+
+		auto it = entries_.find(key);
+		return it != entries_.end() ? it->second : nullptr;
+	}
+
+	void store(const std::string& key, const AVFormatContext* ic) noexcept
+	{
+		auto entry = makePtr<Entry>();
+
+		// the first of comma separated demuxer names is enough to find it again
+		std::string_view name = ic->iformat->name;
+		entry->formatName     = name.substr(0, name.find(','));
+
+		for (unsigned i = 0; i < ic->nb_streams; ++i)
+		{
+			const auto* st = ic->streams[i];
+
+			StreamInfo info;
+			info.par          = Ptr<AVCodecParameters>(avcodec_parameters_alloc(), [](AVCodecParameters* p) { avcodec_parameters_free(&p); });
+			info.avgFrameRate = st->avg_frame_rate;
+			info.rFrameRate   = st->r_frame_rate;
+
+			if (!info.par || avcodec_parameters_copy(info.par.get(), st->codecpar) < 0)
+				return;
+
+			entry->streams.emplace_back(std::move(info));
+		}
+
+		std::lock_guard lock(mutex_);
+		entries_[key] = std::move(entry);
+	}
+
+	static bool restore(const Entry& entry, AVFormatContext* ic) noexcept
+	{
+		if (ic->nb_streams != entry.streams.size())
+			return false;
+
+		for (unsigned i = 0; i < ic->nb_streams; ++i)
+		{
+			const auto* par = ic->streams[i]->codecpar;
+			if (par->codec_type != entry.streams[i].par->codec_type || par->codec_id != entry.streams[i].par->codec_id)
+				return false;
+		}
+
+		for (unsigned i = 0; i < ic->nb_streams; ++i)
+		{
+			auto* st = ic->streams[i];
+			if (!fillUnset(st->codecpar, entry.streams[i].par.get()))
+				return false;
+
+			if (!st->avg_frame_rate.num)
+				st->avg_frame_rate = entry.streams[i].avgFrameRate;
+			if (!st->r_frame_rate.num)
+				st->r_frame_rate = entry.streams[i].rFrameRate;
+		}
+
+		return true;
+	}
+
+	// Copies the cached parameters the demuxer hasn't read from the header of this source
+	static bool fillUnset(AVCodecParameters* par, const AVCodecParameters* cached) noexcept
+	{
+		if (!par->extradata_size && cached->extradata_size > 0)
+		{
+			par->extradata = (uint8_t*) av_mallocz(cached->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+			if (!par->extradata)
+				return false;
+
+			std::memcpy(par->extradata, cached->extradata, cached->extradata_size);
+			par->extradata_size = cached->extradata_size;
+		}
+
+		if (par->format < 0)
+			par->format = cached->format;
+		if (!par->bit_rate)
+			par->bit_rate = cached->bit_rate;
+		if (par->profile == FF_PROFILE_UNKNOWN)
+			par->profile = cached->profile;
+		if (par->level == FF_LEVEL_UNKNOWN)
+			par->level = cached->level;
+
+		if (par->codec_type == AVMEDIA_TYPE_VIDEO)
+		{
+			// the size is taken as a whole, not mixed from two sources
+			if (!par->width || !par->height)
+			{
+				par->width  = cached->width;
+				par->height = cached->height;
+			}
+
+			if (!par->sample_aspect_ratio.num)
+				par->sample_aspect_ratio = cached->sample_aspect_ratio;
+			if (!par->video_delay)
+				par->video_delay = cached->video_delay;
+		}
+		else if (par->codec_type == AVMEDIA_TYPE_AUDIO)
+		{
+			if (!par->sample_rate)
+				par->sample_rate = cached->sample_rate;
+			if (!par->channels)
+			{
+				par->channels       = cached->channels;
+				par->channel_layout = cached->channel_layout;
+			}
+			if (!par->frame_size)
+				par->frame_size = cached->frame_size;
+		}
+
+		return true;
+	}
+
+private:
+	std::mutex mutex_;
+	std::unordered_map<std::string, Ptr<const Entry>> entries_;
+};
+
+}// namespace av
@@ -3,26 +3,59 @@
 #include <av/Decoder.hpp>
 #include <av/Frame.hpp>
 #include <av/InputFormat.hpp>
+#include <av/KeyframeIndex.hpp>
+#include <av/SPSCQueue.hpp>
 #include <av/Scale.hpp>
 #include <av/common.hpp>
 
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <thread>
+
 namespace av
 {
 
+struct ParallelDecodingParams
+{
+	int packetQueueDepth{64};
+	int frameQueueDepth{8};
+	// When set, frames of the stream are handed to the callback on its decoding thread instead of the frame queue
+	std::function<void(Frame&)> videoCallback;
+	std::function<void(Frame&)> audioCallback;
+};
+
 class StreamReader : NoCopyable
 {
 	StreamReader() = default;
 
 public:
-	static Expected<Ptr<StreamReader>> create(std::string_view url, bool enableAudio = false) noexcept
+	static Expected<Ptr<StreamReader>> create(std::string_view url, bool enableAudio = false, const DecoderThreading& threading = {}, const ProbeParams& probe = {},
+	                                          const StreamSelection& selection = {}) noexcept
 	{
-		Ptr<StreamReader> sr{new StreamReader};
+		auto iformExp = SimpleInputFormat::create(url, enableAudio, threading, probe, selection);
+		if (!iformExp)
+			FORWARD_AV_ERROR(iformExp);
 
-		auto iformExp = SimpleInputFormat::create(url, enableAudio);
+		return create(iformExp.value(), enableAudio);
+	}
+
+	// Reads the input through the custom io context, e.g. from memory, instead of opening an url
+	static Expected<Ptr<StreamReader>> create(Ptr<IOContext> io, bool enableAudio = false, const DecoderThreading& threading = {}, const ProbeParams& probe = {},
+	                                          const StreamSelection& selection = {}) noexcept
+	{
+		auto iformExp = SimpleInputFormat::create(std::move(io), enableAudio, threading, probe, selection);
 		if (!iformExp)
 			FORWARD_AV_ERROR(iformExp);
 
-		sr->ic_ = iformExp.value();
+		return create(iformExp.value(), enableAudio);
+	}
+
+	static Expected<Ptr<StreamReader>> create(Ptr<SimpleInputFormat> iform, bool enableAudio) noexcept
+	{
+		Ptr<StreamReader> sr{new StreamReader};
+
+		sr->ic_ = std::move(iform);
 
 		sr->vStream_ = sr->ic_->videoStream();
 
@@ -34,63 +67,278 @@ public:
 
 	~StreamReader()
 	{
+		stopPrefetch();
+		stopParallelDecoding();
+	}
+
+	// Starts a demux thread which reads packets ahead into a bounded queue so I/O stalls don't stall decoding.
+	// maxBytes limits the total size of queued packets, 0 - no limit
+	[[nodiscard]] Expected<void> startPrefetch(int maxPackets = 256, size_t maxBytes = 64 * 1024 * 1024) noexcept
+	{
+		if (prefetchQueue_)
+			RETURN_AV_ERROR("Prefetch is already started");
+
+		if (demuxThread_.joinable())
+			RETURN_AV_ERROR("Prefetch can't be used along with parallel decoding");
+
+		if (maxPackets <= 0)
+			RETURN_AV_ERROR("Invalid prefetch queue depth: {}", maxPackets);
+
+		prefetchQueue_    = makePtr<SPSCQueue<Packet>>(maxPackets, maxBytes);
+		prefetchDepth_    = maxPackets;
+		prefetchMaxBytes_ = maxBytes;
+		prefetchError_.clear();
+		prefetchThread_ = std::thread([this] { prefetchLoop(); });
+
+		return {};
+	}
+
+	// Stops the prefetch thread, packets still queued are dropped. Reading continues from the demuxer position,
+	// so it's mostly useful before a seek, which also restarts prefetch on its own
+	void stopPrefetch() noexcept
+	{
+		if (!prefetchQueue_)
+			return;
+
+		prefetchQueue_->close();
+
+		if (prefetchThread_.joinable())
+			prefetchThread_.join();
+
+		prefetchQueue_.reset();
+	}
+
+	// Runs every stream decoder on its own thread fed by a demux thread, so audio decoding doesn't steal time
+	// from video. Frames are read per stream with readFrame(frame, type) or merged by timestamps with readFrame(frame),
+	// every stream without a callback has to be consumed otherwise its full queue stalls the demuxer.
+	[[nodiscard]] Expected<void> startParallelDecoding(const ParallelDecodingParams& params = {}) noexcept
+	{
+		if (demuxThread_.joinable())
+			RETURN_AV_ERROR("Parallel decoding is already started");
+
+		if (prefetchQueue_)
+			RETURN_AV_ERROR("Parallel decoding can't be used along with prefetch");
+
+		if (!hasDecoders())
+			RETURN_AV_ERROR("Input is opened without decoders, only packets can be read");
+
+		if (params.packetQueueDepth <= 0 || params.frameQueueDepth <= 0)
+			RETURN_AV_ERROR("Invalid queue depth: packets {} frames {}", params.packetQueueDepth, params.frameQueueDepth);
+
+		auto makeWorker = [&](auto& stream, const std::function<void(Frame&)>& callback) {
+			auto w      = makePtr<DecodingWorker>();
+			w->decoder  = std::get<1>(stream);
+			w->index    = std::get<0>(stream)->index;
+			w->timeBase = std::get<0>(stream)->time_base;
+			w->callback = callback;
+			w->packets  = makePtr<SPSCQueue<Packet>>(params.packetQueueDepth);
+
+			if (!callback)
+				w->frames = makePtr<SPSCQueue<Frame>>(params.frameQueueDepth, 0, &mergeSignal_);
+
+			return w;
+		};
+
+		workers_[0] = makeWorker(vStream_, params.videoCallback);
+
+		if (std::get<0>(aStream_))
+			workers_[1] = makeWorker(aStream_, params.audioCallback);
+
+		for (auto& w : workers_)
+		{
+			if (w)
+				w->thread = std::thread([this, w = w.get()] { decodeLoop(*w); });
+		}
+
+		demuxFinished_.store(false, std::memory_order_relaxed);
+		demuxError_.clear();
+		demuxThread_ = std::thread([this] { demuxLoop(); });
+
+		return {};
+	}
+
+	// Waits until the whole input is decoded, intended for the case when every stream is consumed by callbacks
+	[[nodiscard]] Expected<void> waitParallelDecoding() noexcept
+	{
+		if (demuxThread_.joinable())
+			demuxThread_.join();
+
+		for (auto& w : workers_)
+		{
+			if (w && w->thread.joinable())
+				w->thread.join();
+		}
+
+		for (auto& w : workers_)
+		{
+			if (w && !w->error.empty())
+				RETURN_AV_ERROR("Decoding thread failed: {}", w->error);
+		}
+
+		if (!demuxError_.empty())
+			RETURN_AV_ERROR("Demux thread failed: {}", demuxError_);
+
+		return {};
+	}
+
+	// Reads the next frame of the given stream in parallel decoding mode
+	[[nodiscard]] Expected<bool> readFrame(Frame& frame, AVMediaType type) noexcept
+	{
+		auto* w = type == AVMEDIA_TYPE_VIDEO ? workers_[0].get() : type == AVMEDIA_TYPE_AUDIO ? workers_[1].get() : nullptr;
+		if (!w || !w->frames)
+			RETURN_AV_ERROR("No {} frame queue, parallel decoding must be started without a callback for the stream", av_get_media_type_string(type));
+
+		if (w->hasLookahead)
+		{
+			frame.moveRef(w->lookahead);
+			w->hasLookahead = false;
+			return true;
+		}
+
+		if (w->frames->pop(frame))
+			return true;
+
+		return workerEndOfStream(*w);
 	}
 
 	[[nodiscard]] Expected<bool> readFrame(Frame& frame) noexcept
 	{
-		Packet packet;
+		if (demuxThread_.joinable())
+			return readMergedFrame(frame);
+
+		if (pendingPos_ >= pendingCount_)
+		{
+			pendingPos_   = 0;
+			pendingCount_ = 0;
+
+			auto countExp = readFrames(pending_);
+			if (!countExp)
+				FORWARD_AV_ERROR(countExp);
+
+			pendingCount_ = countExp.value();
+
+			if (pendingCount_ == 0)
+				return false;
+		}
+
+		frame.moveRef(pending_[pendingPos_++]);
+
+		return true;
+	}
+
+	// Reads packets until a decoder produces output and returns every frame decoded from that packet
+	// in the reusable frames vector. At the end of input decoders are drained, 0 is returned once everything is read.
+	// Don't mix with readFrame() calls since the latter may keep already decoded frames pending.
+	[[nodiscard]] Expected<int> readFrames(std::vector<Frame>& frames) noexcept
+	{
+		if (demuxThread_.joinable())
+			RETURN_AV_ERROR("readFrames is not available in parallel decoding mode");
+
+		if (!hasDecoders())
+			RETURN_AV_ERROR("Input is opened without decoders, only packets can be read");
 
 		for (;;)
 		{
-			packet.dataUnref();
-			auto successExp = ic_->readFrame(packet);
+			packet_.dataUnref();
+			auto successExp = nextPacket(packet_);
 			if (!successExp)
 				FORWARD_AV_ERROR(successExp);
 
 			if (!successExp.value())
-				return false;
+				return flushDecoders(frames);
 
 			Ptr<Decoder> dec;
-			if (packet.native()->stream_index == std::get<0>(vStream_)->index)
-			{
+			if (packet_.native()->stream_index == std::get<0>(vStream_)->index)
 				dec = std::get<1>(vStream_);
+			else if (std::get<0>(aStream_) && packet_.native()->stream_index == std::get<0>(aStream_)->index)
+				dec = std::get<1>(aStream_);
+			else
+				continue;
 
-				auto resExp = dec->decode(packet, frame);
+			if (seekTarget_ != AV_NOPTS_VALUE && dec == std::get<1>(vStream_))
+			{
+				const auto pts = packet_.native()->pts;
+				dec->skipFrames(pts != AV_NOPTS_VALUE && pts < seekTarget_ ? AVDISCARD_NONREF : AVDISCARD_DEFAULT);
+			}
 
-				if (!resExp)
-					FORWARD_AV_ERROR(resExp);
+			auto resExp = dec->decode(packet_, frames);
+			if (!resExp)
+				FORWARD_AV_ERROR(resExp);
 
-				if (resExp.value() != Result::kSuccess)
-					continue;
+			const int count = dropFramesBeforeSeekTarget(frames, std::get<1>(resExp.value()));
+			if (count > 0)
+				return count;
+		}
+	}
 
-				frame.type(AVMEDIA_TYPE_VIDEO);
+	// Seeks use the index instead of searching keyframes by the demuxer, nullptr resets the index
+	[[nodiscard]] Expected<void> setKeyframeIndex(Ptr<KeyframeIndex> index) noexcept
+	{
+		if (index && index->streamIndex() != std::get<0>(vStream_)->index)
+			RETURN_AV_ERROR("Keyframe index is built for stream #{}, but video stream is #{}", index->streamIndex(), std::get<0>(vStream_)->index);
 
-				return true;
-			}
-			else if (std::get<0>(aStream_) && packet.native()->stream_index == std::get<0>(aStream_)->index)
-			{
-				dec = std::get<1>(aStream_);
+		keyframeIndex_ = std::move(index);
 
-				auto resExp = dec->decode(packet, frame);
+		return {};
+	}
 
-				if (!resExp)
-					FORWARD_AV_ERROR(resExp);
+	[[nodiscard]] Expected<void> loadKeyframeIndex(std::string_view path) noexcept
+	{
+		auto indexExp = KeyframeIndex::load(path);
+		if (!indexExp)
+			FORWARD_AV_ERROR(indexExp);
 
-				if (resExp.value() != Result::kSuccess)
-					continue;
+		return setKeyframeIndex(indexExp.value());
+	}
 
-				frame.type(AVMEDIA_TYPE_AUDIO);
+	// Moves reading position to the video keyframe at or before the timestamp given in timeBase units.
+	// If frameAccurate is set, frames before the timestamp are decoded but not returned, so the next read frame
+	// is the exact target one. Non-reference frames before the target are not reconstructed at all.
+	[[nodiscard]] Expected<void> seek(int64_t timestamp, AVRational timeBase = {1, AV_TIME_BASE}, bool frameAccurate = true) noexcept
+	{
+		if (demuxThread_.joinable())
+			RETURN_AV_ERROR("Seeking is not supported while parallel decoding is running");
 
-				return true;
-			}
-			else
-			{
-				//LOG_ERROR("Unknown stream index {}", packet->stream_index);
-				continue;
-			}
+		// the demuxer can be repositioned only when the prefetch thread doesn't read it, prefetch is resumed after the seek
+		const bool prefetch = prefetchQueue_ != nullptr;
+		stopPrefetch();
+
+		auto* stream  = std::get<0>(vStream_);
+		const auto ts = av_rescale_q(timestamp, timeBase, stream->time_base);
+
+		const auto* keyframe = keyframeIndex_ ? keyframeIndex_->findKeyframe(ts) : nullptr;
+
+		if (keyframe && keyframe->pos >= 0 && ic_->canSeekByte())
+		{
+			auto seekExp = ic_->seekByte(keyframe->pos);
+			if (!seekExp)
+				FORWARD_AV_ERROR(seekExp);
+		}
+		else
+		{
+			auto seekExp = ic_->seek(stream->index, keyframe ? KeyframeIndex::timestamp(*keyframe) : ts);
+			if (!seekExp)
+				FORWARD_AV_ERROR(seekExp);
 		}
+
+		resetDecoders();
+
+		if (frameAccurate && hasDecoders())
+			seekTarget_ = ts;
+
+		if (prefetch)
+			return startPrefetch(prefetchDepth_, prefetchMaxBytes_);
+
+		return {};
 	}
 
+	// False if the input is opened with StreamSelection::openDecoders unset, then only readPacket is available
+	bool hasDecoders() const noexcept
+	{
+		return std::get<1>(vStream_) != nullptr;
+	}
+
+	// Decoder parameters, the input has to be opened with decoders
 	auto pixFmt() const noexcept
 	{
 		return std::get<1>(vStream_)->native()->pix_fmt;
@@ -126,10 +374,387 @@ public:
 		return std::get<1>(aStream_)->native()->sample_fmt;
 	}
 
+	// Reads the next packet of the selected streams without decoding, e.g. for stream copy. Returns false at the end of input
+	[[nodiscard]] Expected<bool> readPacket(Packet& packet) noexcept
+	{
+		if (demuxThread_.joinable())
+			RETURN_AV_ERROR("readPacket is not available in parallel decoding mode");
+
+		for (;;)
+		{
+			packet.dataUnref();
+
+			auto successExp = nextPacket(packet);
+			if (!successExp)
+				FORWARD_AV_ERROR(successExp);
+
+			if (!successExp.value())
+				return false;
+
+			if (isSelectedStream(packet.native()->stream_index))
+				return true;
+		}
+	}
+
+	const AVStream* videoStream() const noexcept
+	{
+		return std::get<0>(vStream_);
+	}
+
+	// null if audio is not enabled
+	const AVStream* audioStream() const noexcept
+	{
+		return std::get<0>(aStream_);
+	}
+
+private:
+	Expected<bool> nextPacket(Packet& packet) noexcept
+	{
+		if (!prefetchQueue_)
+			return ic_->readFrame(packet);
+
+		if (prefetchQueue_->pop(packet))
+			return true;
+
+		if (!prefetchError_.empty())
+			RETURN_AV_ERROR("Demux thread failed: {}", prefetchError_);
+
+		return false;
+	}
+
+	bool isSelectedStream(int index) const noexcept
+	{
+		return index == std::get<0>(vStream_)->index || (std::get<0>(aStream_) && index == std::get<0>(aStream_)->index);
+	}
+
+	void prefetchLoop() noexcept
+	{
+		Packet packet;
+
+		for (;;)
+		{
+			packet.dataUnref();
+			auto successExp = ic_->readFrame(packet);
+			if (!successExp)
+			{
+				prefetchError_ = successExp.errorString();
+				break;
+			}
+
+			if (!successExp.value())
+				break;
+
+			if (!isSelectedStream(packet.native()->stream_index))
+				continue;
+
+			if (!prefetchQueue_->push(packet, packet.native()->size))
+				break;
+		}
+
+		prefetchQueue_->close();
+	}
+
+	struct DecodingWorker
+	{
+		Ptr<Decoder> decoder;
+		int index{-1};
+		AVRational timeBase{};
+		std::function<void(Frame&)> callback;
+		Ptr<SPSCQueue<Packet>> packets;
+		Ptr<SPSCQueue<Frame>> frames;
+		std::thread thread;
+		std::string error;
+		// frame taken out of the queue by the merging reader
+		Frame lookahead;
+		bool hasLookahead{false};
+	};
+
+	void demuxLoop() noexcept
+	{
+		Packet packet;
+
+		for (;;)
+		{
+			packet.dataUnref();
+			auto successExp = ic_->readFrame(packet);
+			if (!successExp)
+			{
+				demuxError_ = successExp.errorString();
+				break;
+			}
+
+			if (!successExp.value())
+				break;
+
+			for (auto& w : workers_)
+			{
+				if (w && w->index == packet.native()->stream_index)
+				{
+					w->packets->push(packet, packet.native()->size);
+					break;
+				}
+			}
+
+			// every decoding thread has stopped
+			if (std::none_of(workers_.begin(), workers_.end(), [](auto& w) { return w && !w->packets->closed(); }))
+				break;
+		}
+
+		// publishes demuxError_ to the reading thread
+		demuxFinished_.store(true, std::memory_order_release);
+
+		for (auto& w : workers_)
+		{
+			if (w)
+				w->packets->close();
+		}
+	}
+
+	void decodeLoop(DecodingWorker& w) noexcept
+	{
+		Packet packet;
+		std::vector<Frame> frames;
+
+		for (bool eof = false; !eof;)
+		{
+			eof = !w.packets->pop(packet);
+
+			auto resExp = eof ? w.decoder->flush(frames) : w.decoder->decode(packet, frames);
+			if (!resExp)
+			{
+				w.error = resExp.errorString();
+				break;
+			}
+
+			const int count = std::get<1>(resExp.value());
+			for (int i = 0; i < count; ++i)
+			{
+				if (w.callback)
+					w.callback(frames[i]);
+				else if (!w.frames->push(frames[i]))
+					eof = true;
+			}
+		}
+
+		w.packets->close();
+
+		if (w.frames)
+			w.frames->close();
+	}
+
+	// demuxError_ is written by the demux thread, it may be read only after the thread has finished
+	bool demuxFailed() const noexcept
+	{
+		return demuxFinished_.load(std::memory_order_acquire) && !demuxError_.empty();
+	}
+
+	Expected<bool> workerEndOfStream(const DecodingWorker& w) noexcept
+	{
+		if (!w.error.empty())
+			RETURN_AV_ERROR("Decoding thread failed: {}", w.error);
+
+		if (demuxFailed())
+			RETURN_AV_ERROR("Demux thread failed: {}", demuxError_);
+
+		return false;
+	}
+
+	Expected<bool> readMergedFrame(Frame& frame) noexcept
+	{
+		for (;;)
+		{
+			const auto s = mergeSignal_.load(std::memory_order_acquire);
+
+			DecodingWorker* next = nullptr;
+			bool waiting         = false;
+
+			for (auto& w : workers_)
+			{
+				if (!w || !w->frames)
+					continue;
+
+				if (!w->hasLookahead)
+					w->hasLookahead = w->frames->tryPop(w->lookahead);
+
+				// the queue could be filled right before it was closed
+				if (!w->hasLookahead && w->frames->closed())
+					w->hasLookahead = w->frames->tryPop(w->lookahead);
+
+				if (!w->hasLookahead)
+				{
+					if (!w->frames->closed())
+						waiting = true;
+					else if (!w->error.empty())
+						return workerEndOfStream(*w);
+
+					continue;
+				}
+
+				if (!next || av_compare_ts(w->lookahead.native()->best_effort_timestamp, w->timeBase,
+				                           next->lookahead.native()->best_effort_timestamp, next->timeBase)
+				                 < 0)
+					next = w.get();
+			}
+
+			// a stream without ready frames may produce an earlier one, but if the decoder of the ready frame
+			// is blocked by its full queue the frame is handed out right away to keep the pipeline moving
+			if (next && (!waiting || next->frames->size() == next->frames->capacity()))
+			{
+				frame.moveRef(next->lookahead);
+				next->hasLookahead = false;
+				return true;
+			}
+
+			if (!next && !waiting)
+			{
+				if (demuxFailed())
+					RETURN_AV_ERROR("Demux thread failed: {}", demuxError_);
+
+				return false;
+			}
+
+			mergeSignal_.wait(s, std::memory_order_acquire);
+		}
+	}
+
+	void stopParallelDecoding() noexcept
+	{
+		for (auto& w : workers_)
+		{
+			if (!w)
+				continue;
+
+			w->packets->close();
+			if (w->frames)
+				w->frames->close();
+		}
+
+		if (demuxThread_.joinable())
+			demuxThread_.join();
+
+		for (auto& w : workers_)
+		{
+			if (w && w->thread.joinable())
+				w->thread.join();
+		}
+	}
+
+	// Compacts the decoded frames removing ones preceding the target of a frame accurate seek
+	int dropFramesBeforeSeekTarget(std::vector<Frame>& frames, int count) noexcept
+	{
+		if (seekTarget_ == AV_NOPTS_VALUE)
+			return count;
+
+		auto* vs     = std::get<0>(vStream_);
+		bool reached = false;
+		int kept     = 0;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const bool video   = frames[i].type() == AVMEDIA_TYPE_VIDEO;
+			const auto* stream = video ? vs : std::get<0>(aStream_);
+			const auto ts      = frames[i].native()->best_effort_timestamp;
+
+			if (ts != AV_NOPTS_VALUE && av_compare_ts(ts, stream->time_base, seekTarget_, vs->time_base) < 0)
+				continue;
+
+			reached = reached || video;
+
+			if (i != kept)
+				std::swap(frames[kept], frames[i]);
+
+			kept++;
+		}
+
+		if (reached)
+		{
+			seekTarget_ = AV_NOPTS_VALUE;
+			std::get<1>(vStream_)->skipFrames(AVDISCARD_DEFAULT);
+		}
+
+		return kept;
+	}
+
+	void resetDecoders() noexcept
+	{
+		if (std::get<1>(vStream_))
+		{
+			std::get<1>(vStream_)->flushBuffers();
+			std::get<1>(vStream_)->skipFrames(AVDISCARD_DEFAULT);
+		}
+
+		if (std::get<1>(aStream_))
+			std::get<1>(aStream_)->flushBuffers();
+
+		pendingPos_   = 0;
+		pendingCount_ = 0;
+		vFlushed_     = false;
+		aFlushed_     = false;
+		seekTarget_   = AV_NOPTS_VALUE;
+	}
+
+	// Drains the decoders at the end of input. Frames before the seek target are dropped like while reading,
+	// so a decoder whose whole output is dropped is followed by the next one
+	Expected<int> flushDecoders(std::vector<Frame>& frames) noexcept
+	{
+		if (!vFlushed_)
+		{
+			vFlushed_ = true;
+
+			auto resExp = std::get<1>(vStream_)->flush(frames);
+			if (!resExp)
+				FORWARD_AV_ERROR(resExp);
+
+			const int count = dropFramesBeforeSeekTarget(frames, std::get<1>(resExp.value()));
+			if (count > 0)
+				return count;
+		}
+
+		if (!aFlushed_ && std::get<1>(aStream_))
+		{
+			aFlushed_ = true;
+
+			auto resExp = std::get<1>(aStream_)->flush(frames);
+			if (!resExp)
+				FORWARD_AV_ERROR(resExp);
+
+			const int count = dropFramesBeforeSeekTarget(frames, std::get<1>(resExp.value()));
+			if (count > 0)
+				return count;
+		}
+
+		// the target is past the last frame
+		if (seekTarget_ != AV_NOPTS_VALUE)
+		{
+			seekTarget_ = AV_NOPTS_VALUE;
+			std::get<1>(vStream_)->skipFrames(AVDISCARD_DEFAULT);
+		}
+
+		return 0;
+	}
+
 private:
 	Ptr<SimpleInputFormat> ic_;
 	std::tuple<AVStream*, Ptr<Decoder>> vStream_;
 	std::tuple<AVStream*, Ptr<Decoder>> aStream_;
+	Packet packet_;
+	std::vector<Frame> pending_;
+	int pendingPos_{0};
+	int pendingCount_{0};
+	bool vFlushed_{false};
+	bool aFlushed_{false};
+	Ptr<SPSCQueue<Packet>> prefetchQueue_;
+	std::thread prefetchThread_;
+	std::string prefetchError_;
+	int prefetchDepth_{0};
+	size_t prefetchMaxBytes_{0};
+	std::array<Ptr<DecodingWorker>, 2> workers_;
+	std::thread demuxThread_;
+	std::string demuxError_;
+	std::atomic<bool> demuxFinished_{false};
+	std::atomic<uint32_t> mergeSignal_{0};
+	Ptr<KeyframeIndex> keyframeIndex_;
+	int64_t seekTarget_{AV_NOPTS_VALUE};
 };
 
 }// namespace av
@@ -1,15 +1,62 @@
 #pragma once
 
+#include <av/BSF.hpp>
 #include <av/Encoder.hpp>
 #include <av/Frame.hpp>
 #include <av/OptSetter.hpp>
 #include <av/OutputFormat.hpp>
 #include <av/Resample.hpp>
-#include <av/Scale.hpp>
+#include <av/SPSCQueue.hpp>
+#include <av/ScaleCache.hpp>
 #include <av/common.hpp>
 
+#include <atomic>
+#include <functional>
+#include <thread>
+
 namespace av
 {
+
+struct SegmentInfo
+{
+	int index{0};
+	// file name of the segment, empty for custom io segments
+	std::string name;
+	// in AV_TIME_BASE units
+	int64_t startTime{0};
+	int64_t duration{0};
+	int64_t bytes{0};
+};
+
+struct SegmentParams
+{
+	// Segment duration in AV_TIME_BASE units, 0 - not limited. Keyframes are forced on this grid
+	int64_t duration{0};
+	// Max segment size in bytes, 0 - not limited. The next frame is forced to be a keyframe
+	// once the size is reached, so a segment exceeds it by the encoder delay
+	int64_t maxBytes{0};
+	// File name pattern with the segment number, e.g. "out_%05d.ts". If empty, it is made of the writer file name
+	// by inserting the number before the extension: "out.ts" -> "out_%05d.ts"
+	std::string pattern;
+	// Opens a custom io context for the segment instead of a file
+	std::function<Expected<Ptr<IOContext>>(int index)> openIO;
+	// Called when a segment is finished and its trailer is written, e.g. to update a playlist
+	std::function<void(const SegmentInfo& info)> onSegment;
+	// Timestamps of every segment start near zero like of a separately recorded file. false keeps the continuous
+	// timeline of the whole recording, e.g. for HLS playlists of mpegts segments. SegmentInfo times are not affected
+	bool resetTimestamps{true};
+	// Private muxer options applied to every segment, e.g. {"movflags", "frag_keyframe+empty_moov+default_base_moof"} for fMP4
+	OptValueMap muxerOptions;
+};
+
+struct PipelineParams
+{
+	// frames queued per stream before write() blocks
+	int frameQueueDepth{4};
+	// encoded packets queued per stream before its encoder blocks
+	int packetQueueDepth{64};
+};
+
 class StreamWriter : NoCopyable
 {
 	StreamWriter() = default;
@@ -29,13 +76,106 @@ public:
 		return sw;
 	}
 
+	// Muxes into the custom io context, e.g. a memory buffer or a user callback. The container format
+	// can't be guessed from a file name here so formatName ("mp4", "mpegts", ...) is required
+	[[nodiscard]] static Expected<Ptr<StreamWriter>> create(Ptr<IOContext> io, std::string_view formatName) noexcept
+	{
+		if (!io)
+			RETURN_AV_ERROR("IO context is null");
+
+		Ptr<StreamWriter> sw{new StreamWriter};
+		sw->io_ = std::move(io);
+
+		auto fcExp = OutputFormat::create({}, formatName);
+		if (!fcExp)
+			FORWARD_AV_ERROR(fcExp);
+
+		sw->formatContext_ = fcExp.value();
+
+		return sw;
+	}
+
 	~StreamWriter()
 	{
 		flushAllStreams();
+
+		if (segmented_)
+			closeSegment();
+	}
+
+	// Cuts the output into segments on keyframes of the first video stream (or the first stream if there is no video).
+	// Encoders are kept open between segments, only the muxer is recreated. Should be called before open()
+	[[nodiscard]] Expected<void> enableSegmentation(SegmentParams params) noexcept
+	{
+		if (params.duration <= 0 && params.maxBytes <= 0)
+			RETURN_AV_ERROR("Segment duration or size must be set");
+
+		if (!params.openIO && params.pattern.empty())
+		{
+			if (io_)
+				RETURN_AV_ERROR("Segments of custom io output require the openIO callback");
+
+			params.pattern = segmentPattern(filename_);
+		}
+
+		if (!params.openIO)
+		{
+			char buf[1024];
+			if (av_get_frame_filename(buf, sizeof(buf), params.pattern.c_str(), 0) < 0)
+				RETURN_AV_ERROR("Segment file name pattern '{}' must contain one number placeholder like %05d", params.pattern);
+		}
+
+		segmentParams_ = std::move(params);
+		segmented_     = true;
+
+		return {};
+	}
+
+	// Moves scaling and encoding of every stream to its own thread and muxing to another one. write() only queues
+	// a reference to the frame, so its data must not be modified afterwards unless it is made writable.
+	// Packets are muxed in dts order across streams. Should be called after all streams are added and open()
+	[[nodiscard]] Expected<void> startPipeline(const PipelineParams& params = {}) noexcept
+	{
+		if (muxThread_.joinable())
+			RETURN_AV_ERROR("Pipeline is already started");
+
+		if (streams_.empty())
+			RETURN_AV_ERROR("No streams to write");
+
+		if (params.frameQueueDepth <= 0 || params.packetQueueDepth <= 0)
+			RETURN_AV_ERROR("Invalid queue depth: frames {} packets {}", params.frameQueueDepth, params.packetQueueDepth);
+
+		for (auto& stream : streams_)
+		{
+			auto w     = makePtr<EncodingWorker>();
+			w->packets = makePtr<SPSCQueue<Packet>>(params.packetQueueDepth, 0, &muxSignal_);
+
+			// packets of copy streams are queued by the writing thread directly
+			if (stream->encoder)
+				w->frames = makePtr<SPSCQueue<Frame>>(params.frameQueueDepth);
+
+			stream->worker = w;
+		}
+
+		for (auto& stream : streams_)
+		{
+			if (stream->encoder)
+				stream->worker->thread = std::thread([this, s = stream.get()] { encodeLoop(*s); });
+		}
+
+		muxThread_ = std::thread([this] { muxLoop(); });
+
+		return {};
 	}
 
 	[[nodiscard]] Expected<void> open() noexcept
 	{
+		if (segmented_)
+			return openSegment(0, formatContext_);
+
+		if (io_)
+			return formatContext_->open(io_);
+
 		return formatContext_->open(filename_);
 	}
 
@@ -56,18 +196,25 @@ public:
 		if (!cOpenEXp)
 			FORWARD_AV_ERROR(cOpenEXp);
 
-		auto frameExp = c->newWriteableVideoFrame();
-		if (!frameExp)
-			FORWARD_AV_ERROR(frameExp);
+		stream->encoder  = c;
+		stream->timeBase = c->native()->time_base;
+
+		// frames having the encoder geometry and format are encoded by reference without scaling
+		stream->frame = makePtr<Frame>();
+		stream->sws   = makePtr<ScaleCache>();
 
-		stream->frame   = frameExp.value();
-		stream->encoder = c;
+		if (inWidth != c->native()->width || inHeight != c->native()->height || inPixFmt != c->native()->pix_fmt)
+		{
+			auto frameExp = c->newWriteableVideoFrame();
+			if (!frameExp)
+				FORWARD_AV_ERROR(frameExp);
 
-		auto swsExp = Scale::create(inWidth, inHeight, inPixFmt, outWidth, outHeight, c->native()->pix_fmt);
-		if (!swsExp)
-			FORWARD_AV_ERROR(swsExp);
+			stream->scaled = frameExp.value();
 
-		stream->sws = swsExp.value();
+			auto swsExp = stream->sws->get(inWidth, inHeight, inPixFmt, c->native()->width, c->native()->height, c->native()->pix_fmt);
+			if (!swsExp)
+				FORWARD_AV_ERROR(swsExp);
+		}
 
 		auto sIndExp = formatContext_->addStream(c);
 		if (!sIndExp)
@@ -121,8 +268,9 @@ public:
 		if (!frameExp)
 			FORWARD_AV_ERROR(frameExp);
 
-		stream->frame   = frameExp.value();
-		stream->encoder = c;
+		stream->frame    = frameExp.value();
+		stream->encoder  = c;
+		stream->timeBase = c->native()->time_base;
 
 		auto swrExp = Resample::create(inChannels, inSampleFmt, inSampleRate, outChannels, c->native()->sample_fmt, outSampleRate);
 		if (!swrExp)
@@ -148,34 +296,102 @@ public:
 		return index;
 	}
 
-	[[nodiscard]] Expected<void> write(Frame& frame, int streamIndex) noexcept
+	// Adds a stream written from packets of the input stream as is, without decoding and encoding.
+	// bsfFilters - optional bitstream filters applied to the packets, e.g. "h264_mp4toannexb" for mp4 -> mpegts
+	[[nodiscard]] Expected<int> addCopyStream(const AVStream* inStream, const char* bsfFilters = nullptr) noexcept
 	{
-		auto& stream = streams_[streamIndex];
+		if (!inStream)
+			RETURN_AV_ERROR("Input stream is null");
+
+		auto stream      = makePtr<Stream>();
+		stream->type     = inStream->codecpar->codec_type;
+		stream->timeBase = inStream->time_base;
 
-		if (stream->type == AVMEDIA_TYPE_VIDEO)
+		const AVCodecParameters* par = inStream->codecpar;
+
+		if (bsfFilters)
 		{
-			stream->sws->scale(frame, *stream->frame);
-			stream->frame->native()->pts = stream->nextPts++;
+			auto bsfExp = BSF::create(bsfFilters, inStream->codecpar, inStream->time_base);
+			if (!bsfExp)
+				FORWARD_AV_ERROR(bsfExp);
+
+			stream->bsf      = bsfExp.value();
+			stream->timeBase = stream->bsf->timeBaseOut();
+			par              = stream->bsf->parOut();
 		}
-		else if (stream->type == AVMEDIA_TYPE_AUDIO)
+
+		stream->par = Ptr<AVCodecParameters>(avcodec_parameters_alloc(), [](AVCodecParameters* p) { avcodec_parameters_free(&p); });
+		if (!stream->par || avcodec_parameters_copy(stream->par.get(), par) < 0)
+			RETURN_AV_ERROR("Failed to copy codec parameters");
+
+		auto sIndExp = formatContext_->addStream(stream->par.get(), stream->timeBase);
+		if (!sIndExp)
+			FORWARD_AV_ERROR(sIndExp);
+
+		stream->index = sIndExp.value();
+		int index     = stream->index;
+
+		streams_.emplace_back(std::move(stream));
+
+		if ((int)streams_.size() - 1 != index)
+			RETURN_AV_ERROR("Stream index {} != streams count - 1 {}", index, streams_.size() - 1);
+
+		LOG_AV_INFO("Added {} copy stream #{} codec: {}", av_get_media_type_string(par->codec_type), index, avcodec_get_name(par->codec_id));
+
+		return index;
+	}
+
+	// Writes an encoded packet to the copy stream, timestamps are in the time base of the input stream.
+	// The packet data is consumed by the muxer
+	[[nodiscard]] Expected<void> writePacket(Packet& packet, int streamIndex) noexcept
+	{
+		auto& stream = streams_[streamIndex];
+
+		if (stream->encoder)
+			RETURN_AV_ERROR("Stream #{} is encoded, frames should be written to it", streamIndex);
+
+		if (!stream->bsf)
 		{
-			stream->swr->convert(frame, *stream->frame);
-			stream->frame->native()->pts = stream->nextPts;
-			stream->nextPts += stream->frame->native()->nb_samples;
+			emitPacket(*stream, packet);
+			return {};
 		}
-		else
-			RETURN_AV_ERROR("Unsupported/unknown stream type: {}", av_get_media_type_string(stream->type));
 
-		auto [res, sz] = stream->encoder->encodeFrame(*stream->frame, stream->packets);
+		auto [res, sz] = stream->bsf->apply(packet, stream->packets);
 
 		if (res == Result::kFail)
-			RETURN_AV_ERROR("Encoder returned failure");
+			RETURN_AV_ERROR("Bitstream filter returned failure");
+
+		writePackets(*stream, sz);
+
+		return {};
+	}
+
+	// keyframe - encode the video frame as a keyframe, e.g. to align keyframes of several outputs
+	[[nodiscard]] Expected<void> write(Frame& frame, int streamIndex, bool keyframe = false) noexcept
+	{
+		auto& stream = streams_[streamIndex];
+
+		if (!stream->encoder)
+			RETURN_AV_ERROR("Stream #{} is a copy stream, packets should be written to it", streamIndex);
+
+		if (!stream->worker)
+			return encode(*stream, frame, keyframe);
+
+		auto& w = *stream->worker;
 
-		for (int i = 0; i < sz; ++i)
+		// the queue recycles AVFrame structs, so only the buffer references (one per plane buffer) are allocated here.
+		// The picture type of the reference carries the keyframe request to the encoding thread
+		w.input                     = frame;
+		w.input.native()->pict_type = keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+		if (!w.frames->push(w.input))
 		{
-			auto expected = formatContext_->writePacket(stream->packets[i], stream->index);
-			if (!expected)
-				LOG_AV_ERROR(expected.errorString());
+			w.input.dataUnref();
+
+			if (!w.error.empty())
+				RETURN_AV_ERROR("Encoding thread of stream #{} failed: {}", streamIndex, w.error);
+
+			RETURN_AV_ERROR("Stream #{} is already flushed", streamIndex);
 		}
 
 		return {};
@@ -185,50 +401,497 @@ public:
 	{
 		auto& stream = streams_[streamIndex];
 
-		if (stream->flushed)
+		if (!stream->worker)
+		{
+			flushEncoder(*stream);
+			return;
+		}
+
+		// the encoding thread flushes the encoder when its queue is drained
+		if (stream->worker->frames)
+			stream->worker->frames->close();
+		else
+		{
+			flushEncoder(*stream);
+			stream->worker->packets->close();
+		}
+	}
+
+	// In pipeline mode also waits until all queued frames are encoded and muxed
+	void flushAllStreams() noexcept
+	{
+		for (auto& stream : streams_)
+		{
+			flushStream(stream->index);
+		}
+
+		if (muxThread_.joinable())
+			waitPipeline();
+	}
+
+	int segmentIndex() const noexcept
+	{
+		return segmentIndex_;
+	}
+
+private:
+	struct Stream;
+
+	[[nodiscard]] Expected<void> encode(Stream& stream, Frame& frame, bool keyframe) noexcept
+	{
+		if (stream.type == AVMEDIA_TYPE_VIDEO)
+		{
+			const auto* f = frame.native();
+			const auto* c = stream.encoder->native();
+
+			if (f->width == c->width && f->height == c->height && f->format == c->pix_fmt)
+			{
+				// the reference has its own pts and picture type, the caller's frame is left intact
+				*stream.frame = frame;
+			}
+			else
+			{
+				// the input geometry may change mid-stream, the scaler is rebound to it.
+				// The encoder may still reference the previous frame, then a pooled one is taken
+				if (!stream.scaled || !av_frame_is_writable(stream.scaled->native()))
+				{
+					auto frameExp = stream.encoder->newWriteableVideoFrame();
+					if (!frameExp)
+						FORWARD_AV_ERROR(frameExp);
+
+					stream.scaled = frameExp.value();
+				}
+
+				auto scaleExp = stream.sws->scale(frame, *stream.scaled);
+				if (!scaleExp)
+					FORWARD_AV_ERROR(scaleExp);
+
+				*stream.frame = *stream.scaled;
+			}
+
+			stream.frame->native()->pts       = stream.nextPts++;
+			stream.frame->native()->pict_type = (segmented_ && forceKeyframe(stream)) || keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+		}
+		else if (stream.type == AVMEDIA_TYPE_AUDIO)
+		{
+			stream.swr->convert(frame, *stream.frame);
+			stream.frame->native()->pts = stream.nextPts;
+			stream.nextPts += stream.frame->native()->nb_samples;
+		}
+		else
+			RETURN_AV_ERROR("Unsupported/unknown stream type: {}", av_get_media_type_string(stream.type));
+
+		auto [res, sz] = stream.encoder->encodeFrame(*stream.frame, stream.packets);
+
+		// the encoder keeps its own reference if it needs the data, don't hold the caller's buffers
+		if (stream.type == AVMEDIA_TYPE_VIDEO)
+			stream.frame->dataUnref();
+
+		if (res == Result::kFail)
+			RETURN_AV_ERROR("Encoder returned failure");
+
+		writePackets(stream, sz);
+
+		return {};
+	}
+
+	void flushEncoder(Stream& stream) noexcept
+	{
+		if (stream.flushed)
+			return;
+
+		stream.flushed = true;
+
+		if (!stream.encoder && !stream.bsf)
 			return;
 
-		auto [res, sz]  = stream->encoder->flush(stream->packets);
-		stream->flushed = true;
+		auto [res, sz] = stream.encoder ? stream.encoder->flush(stream.packets) : stream.bsf->flush(stream.packets);
 
 		if (res == Result::kFail)
 			return;
 
-		for (int i = 0; i < sz; ++i)
+		writePackets(stream, sz);
+	}
+
+	void writePackets(Stream& stream, int count) noexcept
+	{
+		for (int i = 0; i < count; ++i)
+			emitPacket(stream, stream.packets[i]);
+	}
+
+	// Muxes the packet right away or queues it to the mux thread in pipeline mode
+	void emitPacket(Stream& stream, Packet& packet) noexcept
+	{
+		if (stream.worker)
+			stream.worker->packets->push(packet);
+		else
+			muxPacket(stream, packet);
+	}
+
+	void muxPacket(Stream& stream, Packet& packet) noexcept
+	{
+		if (segmented_)
 		{
-			auto expected = formatContext_->writePacket(stream->packets[i], stream->index);
-			if (!expected)
-				LOG_AV_ERROR(expected.errorString());
+			auto splitExp = splitSegment(stream, packet);
+			if (!splitExp)
+				LOG_AV_ERROR(splitExp.errorString());
 		}
+
+		if (segmented_ && segmentParams_.resetTimestamps)
+			rebaseTimestamps(stream, packet);
+
+		auto expected = formatContext_->writePacket(packet, stream.index);
+		if (!expected)
+			LOG_AV_ERROR(expected.errorString());
+
+		muxedBytes_.store(formatContext_->bytesWritten(), std::memory_order_relaxed);
 	}
 
-	void flushAllStreams() noexcept
+	void encodeLoop(Stream& stream) noexcept
+	{
+		auto& w = *stream.worker;
+		Frame frame;
+
+		while (w.frames->pop(frame))
+		{
+			auto encodeExp = encode(stream, frame, frame.native()->pict_type == AV_PICTURE_TYPE_I);
+			frame.dataUnref();
+
+			if (!encodeExp)
+			{
+				w.error = encodeExp.errorString();
+				break;
+			}
+		}
+
+		w.frames->close();
+
+		if (w.error.empty())
+			flushEncoder(stream);
+
+		w.packets->close();
+	}
+
+	void muxLoop() noexcept
+	{
+		for (;;)
+		{
+			const auto s = muxSignal_.load(std::memory_order_acquire);
+
+			Stream* next = nullptr;
+			bool waiting = false;
+			bool full    = false;
+
+			for (auto& stream : streams_)
+			{
+				auto& w = *stream->worker;
+
+				if (!w.hasLookahead)
+					w.hasLookahead = w.packets->tryPop(w.lookahead);
+
+				// the queue could be filled right before it was closed
+				if (!w.hasLookahead && w.packets->closed())
+					w.hasLookahead = w.packets->tryPop(w.lookahead);
+
+				if (!w.hasLookahead)
+				{
+					waiting = waiting || !w.packets->closed();
+					continue;
+				}
+
+				full = full || w.packets->size() == w.packets->capacity();
+
+				if (!next || av_compare_ts(w.lookahead.native()->dts, stream->timeBase, next->worker->lookahead.native()->dts, next->timeBase) < 0)
+					next = stream.get();
+			}
+
+			// a stream without ready packets may produce an earlier one, but if some encoder is blocked
+			// by its full queue the earliest ready packet is muxed right away to keep the pipeline moving
+			if (next && (!waiting || full))
+			{
+				muxPacket(*next, next->worker->lookahead);
+				next->worker->lookahead.dataUnref();
+				next->worker->hasLookahead = false;
+				continue;
+			}
+
+			if (!next && !waiting)
+				break;
+
+			muxSignal_.wait(s, std::memory_order_acquire);
+		}
+	}
+
+	void waitPipeline() noexcept
 	{
 		for (auto& stream : streams_)
 		{
-			flushStream(stream->index);
+			auto& w = *stream->worker;
+			if (w.thread.joinable())
+				w.thread.join();
+
+			if (!w.error.empty())
+				LOG_AV_ERROR("Encoding thread of stream #{} failed: {}", stream->index, w.error);
+		}
+
+		muxThread_.join();
+	}
+
+	int referenceStream() const noexcept
+	{
+		for (const auto& stream : streams_)
+		{
+			if (stream->type == AVMEDIA_TYPE_VIDEO)
+				return stream->index;
+		}
+
+		return 0;
+	}
+
+	// Returns true if the next frame of the video stream must be a keyframe to start a segment
+	bool forceKeyframe(Stream& stream) noexcept
+	{
+		const auto time = av_rescale_q(stream.frame->native()->pts, stream.timeBase, AV_TIME_BASE_Q);
+
+		bool force = false;
+		if (segmentParams_.duration > 0 && time >= stream.nextKeyframeTime)
+		{
+			stream.nextKeyframeTime = (time / segmentParams_.duration + 1) * segmentParams_.duration;
+			force                   = true;
+		}
+
+		// runs on the encoding thread in pipeline mode, so the muxer is not touched here
+		if (segmentParams_.maxBytes > 0 && stream.index == referenceStream() && !sizeKeyframeForced_
+		    && muxedBytes_.load(std::memory_order_relaxed) >= segmentParams_.maxBytes)
+		{
+			sizeKeyframeForced_ = true;
+			force               = true;
+		}
+
+		return force;
+	}
+
+	// Starts the next segment before the keyframe of the reference stream if the current one is long or large enough
+	[[nodiscard]] Expected<void> splitSegment(Stream& stream, Packet& packet) noexcept
+	{
+		const auto* p = packet.native();
+		if (stream.index != referenceStream() || p->pts == AV_NOPTS_VALUE)
+			return {};
+
+		const auto& tb  = stream.timeBase;
+		const auto time = av_rescale_q(p->pts, tb, AV_TIME_BASE_Q);
+
+		if (segmentStart_ == AV_NOPTS_VALUE)
+		{
+			segmentStart_ = time;
+			nextSplit_    = segmentParams_.duration > 0 ? (time / segmentParams_.duration + 1) * segmentParams_.duration : INT64_MAX;
+		}
+
+		const bool split = (p->flags & AV_PKT_FLAG_KEY) && time > segmentStart_
+		                   && (time >= nextSplit_ || (segmentParams_.maxBytes > 0 && formatContext_->bytesWritten() >= segmentParams_.maxBytes));
+
+		if (split)
+		{
+			segmentEnd_ = time;
+			closeSegment();
+
+			Ptr<OutputFormat> fc;
+			auto openExp = openSegment(segmentIndex_ + 1, fc);
+			if (!openExp)
+				FORWARD_AV_ERROR(openExp);
+
+			segmentStart_       = time;
+			sizeKeyframeForced_ = false;
+			// the keyframe starts the timeline of the new segment
+			segmentOffset_ = av_rescale_q(p->dts != AV_NOPTS_VALUE ? p->dts : p->pts, tb, AV_TIME_BASE_Q);
+
+			if (segmentParams_.duration > 0)
+				nextSplit_ = (time / segmentParams_.duration + 1) * segmentParams_.duration;
+		}
+
+		segmentEnd_ = std::max(segmentEnd_, time + av_rescale_q(p->duration, tb, AV_TIME_BASE_Q));
+
+		return {};
+	}
+
+	// Shifts packet timestamps by the start of the current segment, the first segment starts at the first muxed packet.
+	// Packets of other streams interleaved slightly before the keyframe get small negative timestamps,
+	// which the muxer shifts if the format doesn't allow them
+	void rebaseTimestamps(const Stream& stream, Packet& packet) noexcept
+	{
+		auto* p = packet.native();
+
+		if (segmentOffset_ == AV_NOPTS_VALUE)
+		{
+			const auto ts = p->dts != AV_NOPTS_VALUE ? p->dts : p->pts;
+			if (ts == AV_NOPTS_VALUE)
+				return;
+
+			segmentOffset_ = av_rescale_q(ts, stream.timeBase, AV_TIME_BASE_Q);
+		}
+
+		const auto offset = av_rescale_q(segmentOffset_, AV_TIME_BASE_Q, stream.timeBase);
+
+		if (p->pts != AV_NOPTS_VALUE)
+			p->pts -= offset;
+		if (p->dts != AV_NOPTS_VALUE)
+			p->dts -= offset;
+	}
+
+	// "dir/out.ts" -> "dir/out_%05d.ts", '%' of the file name itself is escaped
+	static std::string segmentPattern(std::string_view filename) noexcept
+	{
+		std::string escaped;
+		for (char c : filename)
+		{
+			if (c == '%')
+				escaped += '%';
+			escaped += c;
+		}
+
+		// a dot of a directory or a leading dot of a hidden file doesn't start an extension
+		const auto slash     = escaped.find_last_of('/');
+		const auto nameStart = slash == std::string::npos ? 0 : slash + 1;
+		auto dot             = escaped.find_last_of('.');
+		if (dot == std::string::npos || dot <= nameStart)
+			dot = escaped.size();
+
+		return escaped.substr(0, dot) + "_%05d" + escaped.substr(dot);
+	}
+
+	// fc - muxer with the streams already added, a new one is created if null
+	[[nodiscard]] Expected<void> openSegment(int index, Ptr<OutputFormat> fc) noexcept
+	{
+		Ptr<IOContext> io = index == 0 ? io_ : nullptr;
+		std::string name;
+
+		if (segmentParams_.openIO)
+		{
+			auto ioExp = segmentParams_.openIO(index);
+			if (!ioExp)
+				FORWARD_AV_ERROR(ioExp);
+
+			io = ioExp.value();
+		}
+		else if (!io)
+		{
+			char buf[1024];
+			if (av_get_frame_filename(buf, sizeof(buf), segmentParams_.pattern.c_str(), index) < 0)
+				RETURN_AV_ERROR("Invalid segment file name pattern '{}'", segmentParams_.pattern);
+
+			name = buf;
+		}
+
+		if (!fc)
+		{
+			auto fcExp = OutputFormat::create(io ? std::string_view{} : name, formatContext_->native()->oformat->name);
+			if (!fcExp)
+				FORWARD_AV_ERROR(fcExp);
+
+			fc = fcExp.value();
+
+			for (auto& stream : streams_)
+			{
+				auto sIndExp = stream->encoder ? fc->addStream(stream->encoder) : fc->addStream(stream->par.get(), stream->timeBase);
+				if (!sIndExp)
+					FORWARD_AV_ERROR(sIndExp);
+			}
+		}
+
+		fc->setMuxerOptions(segmentParams_.muxerOptions);
+
+		auto openExp = io ? fc->open(io) : fc->open(name);
+		if (!openExp)
+			FORWARD_AV_ERROR(openExp);
+
+		formatContext_ = fc;
+		segmentIndex_  = index;
+		segmentName_   = std::move(name);
+
+		return {};
+	}
+
+	void closeSegment() noexcept
+	{
+		auto closeExp = formatContext_->close();
+		if (!closeExp)
+			LOG_AV_ERROR(closeExp.errorString());
+
+		if (segmentParams_.onSegment && segmentStart_ != AV_NOPTS_VALUE)
+		{
+			SegmentInfo info;
+			info.index     = segmentIndex_;
+			info.name      = segmentName_;
+			info.startTime = segmentStart_;
+			info.duration  = segmentEnd_ - segmentStart_;
+			info.bytes     = formatContext_->bytesWritten();
+
+			segmentParams_.onSegment(info);
 		}
 	}
 
 private:
+	struct EncodingWorker
+	{
+		// null for copy streams
+		Ptr<SPSCQueue<Frame>> frames;
+		Ptr<SPSCQueue<Packet>> packets;
+		// reference to the written frame exchanged with a recycled one by the queue
+		Frame input;
+		std::thread thread;
+		std::string error;
+		// packet taken out of the queue by the mux thread
+		Packet lookahead;
+		bool hasLookahead{false};
+	};
+
 	struct Stream
 	{
 		AVMediaType type{AVMEDIA_TYPE_UNKNOWN};
 		int index{-1};
+		// null for copy streams
 		Ptr<Encoder> encoder;
-		Ptr<Scale> sws;
+		// time base of packets written to the muxer
+		AVRational timeBase{};
+		// copy streams only
+		Ptr<BSF> bsf;
+		Ptr<AVCodecParameters> par;
+		// video streams only
+		Ptr<ScaleCache> sws;
+		// encoder geometry frame the input is scaled into, null until a frame needs scaling
+		Ptr<Frame> scaled;
 		Ptr<Resample> swr;
 		Ptr<Frame> frame;
 		std::vector<Packet> packets;
 		int nextPts{0};
 		int sampleCount{0};
 		bool flushed{false};
+		// in AV_TIME_BASE units
+		int64_t nextKeyframeTime{0};
+		// pipeline mode only
+		Ptr<EncodingWorker> worker;
 	};
 
 private:
 	std::string filename_;
+	Ptr<IOContext> io_;
 	std::vector<Ptr<Stream>> streams_;
 	Ptr<OutputFormat> formatContext_;
+	// segmentation
+	SegmentParams segmentParams_;
+	bool segmented_{false};
+	int segmentIndex_{0};
+	std::string segmentName_;
+	int64_t segmentStart_{AV_NOPTS_VALUE};
+	int64_t segmentEnd_{0};
+	// in AV_TIME_BASE units, subtracted from timestamps of the current segment
+	int64_t segmentOffset_{AV_NOPTS_VALUE};
+	int64_t nextSplit_{INT64_MAX};
+	std::atomic<bool> sizeKeyframeForced_{false};
+	std::atomic<int64_t> muxedBytes_{0};
+	// pipeline
+	std::thread muxThread_;
+	std::atomic<uint32_t> muxSignal_{0};
 };
 
 }// namespace av
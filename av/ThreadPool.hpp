@@ -0,0 +1,119 @@
+#pragma once
+
+#include <av/common.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace av
+{
+
+// Fixed set of threads running fork-join jobs: run() splits a job into tasks, executes them on the pool threads
+// and the calling one and returns when all tasks are done. Intended for short data parallel jobs like scaling bands.
+class ThreadPool : NoCopyable
+{
+public:
+	// threads - total number of threads including the one calling run()
+	explicit ThreadPool(int threads) noexcept
+	{
+		for (int i = 1; i < threads; ++i)
+			threads_.emplace_back([this] { loop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard lock(mutex_);
+			stop_ = true;
+		}
+
+		wake_.notify_all();
+
+		for (auto& t : threads_)
+			t.join();
+	}
+
+	int size() const noexcept
+	{
+		return (int) threads_.size() + 1;
+	}
+
+	// Runs task(i) for every i in [0, count). Jobs of different callers are serialized
+	void run(int count, const std::function<void(int)>& task) noexcept
+	{
+		std::lock_guard runLock(runMutex_);
+
+		{
+			std::lock_guard lock(mutex_);
+			task_    = &task;
+			count_   = count;
+			next_    = 0;
+			pending_ = count;
+		}
+
+		wake_.notify_all();
+
+		work();
+
+		std::unique_lock lock(mutex_);
+		done_.wait(lock, [this] { return pending_ == 0; });
+		task_ = nullptr;
+	}
+
+private:
+	void loop() noexcept
+	{
+		for (;;)
+		{
+			{
+				std::unique_lock lock(mutex_);
+				wake_.wait(lock, [this] { return stop_ || next_ < count_; });
+
+				if (stop_)
+					return;
+			}
+
+			work();
+		}
+	}
+
+	void work() noexcept
+	{
+		for (;;)
+		{
+			int i                                = 0;
+			const std::function<void(int)>* task = nullptr;
+
+			{
+				std::lock_guard lock(mutex_);
+				if (next_ >= count_)
+					return;
+
+				i    = next_++;
+				task = task_;
+			}
+
+			(*task)(i);
+
+			std::lock_guard lock(mutex_);
+			if (--pending_ == 0)
+				done_.notify_all();
+		}
+	}
+
+private:
+	std::vector<std::thread> threads_;
+	std::mutex runMutex_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	const std::function<void(int)>* task_{nullptr};
+	int count_{0};
+	int next_{0};
+	int pending_{0};
+	bool stop_{false};
+};
+
+}// namespace av
@@ -3,7 +3,7 @@
 #include <av/Decoder.hpp>
 #include <av/Frame.hpp>
 #include <av/InputFormat.hpp>
-#include <av/Scale.hpp>
+#include <av/ScaleCache.hpp>
 #include <av/common.hpp>
 
 namespace av
@@ -12,10 +12,24 @@ namespace av
 struct VideoCaptureParams
 {
 	std::string url;
+	// When set the input is read through the custom io context and url is used only for logging
+	Ptr<IOContext> io;
+	// Read a local file url through a memory mapping instead of the file protocol. Saves the read syscalls,
+	// the data is still copied from the mapping into the avformat io buffer. The url stays the stream info cache key
+	bool mmapInput{false};
 	bool rawMode{false};
 	bool useSEITimestamps{false};
 	int targetFrameWidth{0};
 	int targetFrameHeight{0};
+	DecoderThreading decoderThreading;
+	// Only keyframes are read and decoded, useful for thumbnailing and coarse analytics
+	bool keyframesOnly{false};
+	// Decode at reduced resolution (lowres) when the codec supports it and the target size is small enough
+	bool allowLowres{true};
+	// Algorithm and threads of the conversion to the target frame, SWS_BILINEAR or SWS_POINT
+	// enable the SIMD kernels for the common decoder formats
+	ScaleParams scale;
+	ProbeParams probe;
 };
 
 class VideoCapture : NoCopyable
@@ -28,13 +42,25 @@ public:
 		Ptr<VideoCapture> sr{new VideoCapture};
 		sr->params_ = params;
 
-		auto err            = avformat_open_input(&sr->ic_, sr->params_.url.data(), nullptr, nullptr);
-		if (err < 0)
-			RETURN_AV_ERROR("Cannot open input '{}': {}", sr->params_.url, avErrorStr(err));
+		if (sr->params_.mmapInput && !sr->params_.io)
+		{
+			auto ioExp = IOContext::createMapped(sr->params_.url);
+			if (!ioExp)
+				FORWARD_AV_ERROR(ioExp);
+
+			sr->params_.io = ioExp.value();
+		}
+
+		// a mapped file is identified by its path like a plain url
+		auto probe = sr->params_.probe;
+		if (sr->params_.io && probe.cacheKey.empty())
+			probe.cacheKey = StreamInfoCache::sourceKey(sr->params_.io->sourcePath());
+
+		auto icExp = StreamInfoCache::instance().openInput(sr->params_.url, probe, sr->params_.io ? sr->params_.io->native() : nullptr);
+		if (!icExp)
+			FORWARD_AV_ERROR(icExp);
 
-		err = avformat_find_stream_info(sr->ic_, nullptr);
-		if (err < 0)
-			RETURN_AV_ERROR("Cannot find stream info: {}", avErrorStr(err));
+		sr->ic_ = icExp.value();
 
 		{
 			auto ret = sr->findBestStream();
@@ -68,46 +94,48 @@ public:
 			if (packet.native()->stream_index != stream_->index)
 				continue;
 
+			if (params_.keyframesOnly && !(packet.native()->flags & AV_PKT_FLAG_KEY))
+				continue;
+
 			return true;
 		}
 	}
 
+	// Decodes the next frame straight into mat as RGB24 of the target size. The mat is (re)allocated only
+	// if its size or type differs, so reading into the same mat doesn't allocate or copy. It is left untouched
+	// if there are no more frames. In raw mode mat gets a copy of the next packet, see readFrameView to avoid it
 	[[nodiscard]] Expected<bool> readFrame(cv::Mat& mat) noexcept
 	{
 		if(!params_.rawMode)
 		{
 			Frame frame;
 
-			{
-				auto e = readFrameDecoded(frame);
-				if (!e)
-					FORWARD_AV_ERROR(e);
-
-				if (!e.value())
-					return false;
-			}
-
-			scale_->scale(frame, *swsFrame_);
+			auto successExp = readFrameDecoded(frame);
+			if (!successExp)
+				FORWARD_AV_ERROR(successExp);
 
-			const auto data = swsFrame_->native()->data[0];
-			const auto step = swsFrame_->native()->linesize[0];
+			if (!successExp.value())
+				return false;
 
 			try
 			{
-				const cv::Mat tmp(targetFrameHeight(), targetFameWidth(), CV_MAKETYPE(CV_8U, 3), data, step);
-				tmp.copyTo(mat);
+				mat.create(targetFrameHeight(), targetFameWidth(), CV_MAKETYPE(CV_8U, 3));
 			}
 			catch (const std::exception& e)
 			{
 				RETURN_AV_ERROR("opencv exception: {}", e.what());
 			}
 
+			auto scaleExp = scaleFrame(frame, mat.data, (int) mat.step[0]);
+			if (!scaleExp)
+				FORWARD_AV_ERROR(scaleExp);
+
 			return true;
 		}
 		else
 		{
-			Packet pkt;
-			auto e = readFrameRaw(pkt);
+			cv::Mat view;
+			auto e = readFrameView(view);
 			if(!e)
 				FORWARD_AV_ERROR(e);
 
@@ -116,10 +144,7 @@ public:
 
 			try
 			{
-				const auto data = pkt.native()->data;
-				const auto step = pkt.native()->size;
-				const cv::Mat tmp(1, pkt.native()->size, CV_MAKETYPE(CV_8U, 1), data, step);
-				tmp.copyTo(mat);
+				view.copyTo(mat);
 			}
 			catch (const std::exception& e)
 			{
@@ -130,6 +155,59 @@ public:
 		}
 	}
 
+	// Decodes the next frame into a caller owned RGB24 buffer of the target size with linesize bytes per row
+	[[nodiscard]] Expected<bool> readFrame(uint8_t* data, int linesize) noexcept
+	{
+		if (params_.rawMode)
+			RETURN_AV_ERROR("Decoded frames are not available in raw mode");
+
+		if (linesize < targetFameWidth() * 3)
+			RETURN_AV_ERROR("Linesize {} is less than the row size {}", linesize, targetFameWidth() * 3);
+
+		Frame frame;
+
+		{
+			auto e = readFrameDecoded(frame);
+			if (!e)
+				FORWARD_AV_ERROR(e);
+
+			if (!e.value())
+				return false;
+		}
+
+		auto scaleExp = scaleFrame(frame, data, linesize);
+		if (!scaleExp)
+			FORWARD_AV_ERROR(scaleExp);
+
+		return true;
+	}
+
+	// Raw mode only: view is set to a 1 x size CV_8UC1 header over the data of the next packet without copying it.
+	// The view borrows the packet buffer and is valid until the next read
+	[[nodiscard]] Expected<bool> readFrameView(cv::Mat& view) noexcept
+	{
+		if (!params_.rawMode)
+			RETURN_AV_ERROR("Packet views are available only in raw mode");
+
+		auto e = readFrameRaw(rawPacket_);
+		if(!e)
+			FORWARD_AV_ERROR(e);
+
+		if(!e.value())
+			return false;
+
+		try
+		{
+			view = cv::Mat(1, rawPacket_.native()->size, CV_MAKETYPE(CV_8U, 1), rawPacket_.native()->data);
+		}
+		catch (const std::exception& e)
+		{
+			RETURN_AV_ERROR("opencv exception: {}", e.what());
+		}
+
+		return true;
+	}
+
 	auto pixFmt() const noexcept
 	{
 		return (AVPixelFormat)stream_->codecpar->format;
@@ -188,32 +266,44 @@ private:
 
 	[[nodiscard]] Expected<bool> readFrameDecoded(Frame& frame) noexcept
 	{
-		Packet packet;
-
-		for (;;)
+		while (decodedPos_ >= decodedCount_)
 		{
-			packet.dataUnref();
+			decodedPos_   = 0;
+			decodedCount_ = 0;
+
+			if (decoderFlushed_)
+				return false;
+
+			packet_.dataUnref();
 
-			auto successExp = readFrameRaw(packet);
+			auto successExp = readFrameRaw(packet_);
 			if (!successExp)
 				FORWARD_AV_ERROR(successExp);
 
-			auto resExp = decoder_->decode(packet, frame);
+			// at the end of input drain frames buffered inside the decoder
+			if (!successExp.value())
+				decoderFlushed_ = true;
 
+			auto resExp = successExp.value() ? decoder_->decode(packet_, decoded_) : decoder_->flush(decoded_);
 			if (!resExp)
 				FORWARD_AV_ERROR(resExp);
 
-			if(resExp.value() == Result::kEOF)
-				return false;
+			decodedCount_ = std::get<1>(resExp.value());
+		}
 
-			if (resExp.value() != Result::kSuccess)
-				continue;
+		frame.moveRef(decoded_[decodedPos_++]);
 
-			frame.type(AVMEDIA_TYPE_VIDEO);
+		return true;
+	}
 
-			return true;
+	// Converts the decoded frame into an RGB24 buffer of the target size
+	[[nodiscard]] Expected<void> scaleFrame(const Frame& frame, uint8_t* data, int linesize) noexcept
+	{
+		uint8_t* dst[4]    = {data};
+		int dstLinesize[4] = {linesize};
 
-		}
+		// decoded frames may change the resolution mid-stream
+		return scale_->scale(frame, dst, dstLinesize, targetFameWidth(), targetFrameHeight(), AV_PIX_FMT_RGB24);
 	}
 
 	Expected<void> findBestStream() noexcept
@@ -238,44 +328,76 @@ private:
 
 		stream_ = ic_->streams[stream_i];
 
+		// the demuxer doesn't need to read and parse streams we never use
+		for (unsigned i = 0; i < ic_->nb_streams; ++i)
+		{
+			if (ic_->streams[i] != stream_)
+				ic_->streams[i]->discard = AVDISCARD_ALL;
+		}
+
 		if(!params_.rawMode)
 		{
-			auto decContext = Decoder::create(dec, ic_->streams[stream_i], framerate_);
+			params_.targetFrameWidth = params_.targetFrameWidth > 0 ? params_.targetFrameWidth : nativeFrameWidth();
+			params_.targetFrameHeight = params_.targetFrameHeight > 0 ? params_.targetFrameHeight : nativeFrameHeight();
+
+			const int lowres = params_.allowLowres ? chooseLowres(dec) : 0;
+
+			auto decContext = Decoder::create(dec, ic_->streams[stream_i], framerate_, params_.decoderThreading, lowres);
 
 			if (!decContext)
 				FORWARD_AV_ERROR(decContext);
 
 			decoder_ = decContext.value();
 
-			params_.targetFrameWidth = params_.targetFrameWidth > 0 ? params_.targetFrameWidth : nativeFrameWidth();
-			params_.targetFrameHeight = params_.targetFrameHeight > 0 ? params_.targetFrameHeight : nativeFrameHeight();
+			if (params_.keyframesOnly)
+				decoder_->skipFrames(AVDISCARD_NONKEY);
 
-			auto scaleExp = Scale::create(decoder_->native()->coded_width, decoder_->native()->coded_height,
-			                              pixFmt(), params_.targetFrameWidth, params_.targetFrameHeight, AV_PIX_FMT_RGB24);
+			// the scaler takes the reduced decoder output
+			const int decodedWidth  = AV_CEIL_RSHIFT(nativeFrameWidth(), lowres);
+			const int decodedHeight = AV_CEIL_RSHIFT(nativeFrameHeight(), lowres);
 
-			if(!scaleExp)
-				FORWARD_AV_ERROR(scaleExp);
+			if (lowres > 0)
+				LOG_AV_INFO("Decoding {}x{} at lowres {}: {}x{}", nativeFrameWidth(), nativeFrameHeight(), lowres, decodedWidth, decodedHeight);
 
-			scale_ = scaleExp.value();
+			scale_ = makePtr<ScaleCache>(params_.scale);
 
-			auto frameExp = Frame::create(params_.targetFrameWidth, params_.targetFrameHeight, AV_PIX_FMT_RGB24);
-			if(!frameExp)
-				FORWARD_AV_ERROR(frameExp);
+			// created up front so an unsupported conversion fails here rather than on the first frame
+			auto scaleExp = scale_->get(decodedWidth, decodedHeight,
+			                            pixFmt(), params_.targetFrameWidth, params_.targetFrameHeight, AV_PIX_FMT_RGB24);
 
-			swsFrame_ = frameExp.value();
+			if(!scaleExp)
+				FORWARD_AV_ERROR(scaleExp);
 		}
 
 		return {};
 	}
 
+	// Picks the largest decoding resolution reduction still keeping the frame not smaller than the target size
+	int chooseLowres(const AVCodec* codec) const noexcept
+	{
+		int lowres = 0;
+		while (lowres < codec->max_lowres
+		       && AV_CEIL_RSHIFT(nativeFrameWidth(), lowres + 1) >= params_.targetFrameWidth
+		       && AV_CEIL_RSHIFT(nativeFrameHeight(), lowres + 1) >= params_.targetFrameHeight)
+			lowres++;
+
+		return lowres;
+	}
+
 private:
 	VideoCaptureParams params_;
 	AVFormatContext* ic_{nullptr};
 	AVStream* stream_{nullptr};
 	AVRational framerate_{};
 	Ptr<Decoder> decoder_;
-	Ptr<Scale> scale_;
-	Ptr<Frame> swsFrame_;
+	Ptr<ScaleCache> scale_;
+	Packet packet_;
+	// raw mode, borrowed by views until the next read
+	Packet rawPacket_;
+	std::vector<Frame> decoded_;
+	int decodedPos_{0};
+	int decodedCount_{0};
+	bool decoderFlushed_{false};
 };
 
 }
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <av/StreamReader.hpp>
+
+namespace av
+{
+void writeLog(LogLevel level, internal::SourceLocation&& loc, std::string msg) noexcept
+{
+	std::cerr << loc.toString() << ": " << msg << std::endl;
+}
+}// namespace av
+
+template<typename... Args>
+void println(std::string_view fmt, Args&&... args) noexcept
+{
+	std::cout << av::internal::format(fmt, std::forward<Args>(args)...) << std::endl;
+}
+
+template<typename Return>
+Return assertExpected(av::Expected<Return>&& expected) noexcept
+{
+	if (!expected)
+	{
+		std::cerr << " === Expected failure == \n"
+		          << expected.errorString() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if constexpr (std::is_same_v<Return, void>)
+		return;
+	else
+		return expected.value();
+}
+
+// Decodes up to maxFrames video frames and returns decoded fps
+double runDecode(std::string_view input, const av::DecoderThreading& threading, int maxFrames) noexcept
+{
+	auto reader = assertExpected(av::StreamReader::create(input, false, threading));
+
+	av::Frame frame;
+	int n = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	while (n < maxFrames && assertExpected(reader->readFrame(frame)))
+		n++;
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	return n / elapsed.count();
+}
+
+int main(int argc, const char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: decode_bench <input> [max frames] [frame|slice|auto]" << std::endl;
+		return 0;
+	}
+
+	std::string_view input(argv[1]);
+	int maxFrames = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+	av::DecoderThreading threading;
+	if (argc > 3)
+	{
+		std::string_view type(argv[3]);
+		if (type == "frame")
+			threading.type = av::DecoderThreadType::kFrame;
+		else if (type == "slice")
+			threading.type = av::DecoderThreadType::kSlice;
+	}
+
+	const int maxThreads = std::max(1, (int) std::thread::hardware_concurrency());
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		threading.threadCount = threads;
+		println("threads: {} fps: {}", threads, runDecode(input, threading, maxFrames));
+	}
+
+	threading.threadCount = 0;
+	println("threads: auto fps: {}", runDecode(input, threading, maxFrames));
+
+	return 0;
+}
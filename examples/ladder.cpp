@@ -0,0 +1,84 @@
+#include <chrono>
+#include <iostream>
+
+#include <av/LadderWriter.hpp>
+#include <av/StreamReader.hpp>
+
+namespace av
+{
+void writeLog(LogLevel level, internal::SourceLocation&& loc, std::string msg) noexcept
+{
+	std::cerr << loc.toString() << ": " << msg << std::endl;
+}
+}// namespace av
+
+template<typename... Args>
+void println(std::string_view fmt, Args&&... args) noexcept
+{
+	std::cout << av::internal::format(fmt, std::forward<Args>(args)...) << std::endl;
+}
+
+template<typename Return>
+Return assertExpected(av::Expected<Return>&& expected) noexcept
+{
+	if (!expected)
+	{
+		std::cerr << " === Expected failure == \n"
+		          << expected.errorString() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if constexpr (std::is_same_v<Return, void>)
+		return;
+	else
+		return expected.value();
+}
+
+// Decodes the input once and encodes it into 1080p, 720p and 480p renditions with aligned keyframes
+int main(int argc, const char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: ladder <input> <output prefix>" << std::endl;
+		return 0;
+	}
+
+	std::string_view input(argv[1]);
+	std::string prefix(argv[2]);
+
+	auto reader = assertExpected(av::StreamReader::create(input, false));
+
+	std::vector<av::Rendition> renditions;
+	for (int height : {1080, 720, 480})
+	{
+		av::Rendition r;
+		r.filename    = prefix + "_" + std::to_string(height) + "p.mp4";
+		r.codec       = std::string("libx264");
+		r.width       = height * 16 / 9 / 2 * 2;
+		r.height      = height;
+		r.codecParams = {{"preset", "veryfast"}, {"x264-params", "scenecut=0"}};
+
+		renditions.emplace_back(std::move(r));
+	}
+
+	auto ladder = assertExpected(av::LadderWriter::create(reader->frameWidth(), reader->frameHeight(), reader->pixFmt(),
+	                                                      av_inv_q(reader->framerate()), renditions));
+
+	const auto start = std::chrono::steady_clock::now();
+
+	av::Frame frame;
+	int count = 0;
+
+	while (assertExpected(reader->readFrame(frame)))
+	{
+		assertExpected(ladder->write(frame));
+		count++;
+	}
+
+	ladder->flush();
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	println("Encoded {} frames into {} renditions at {} fps", count, ladder->size(), count / elapsed.count());
+
+	return 0;
+}
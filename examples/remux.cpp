@@ -0,0 +1,90 @@
+#include <chrono>
+#include <iostream>
+
+#include <av/StreamReader.hpp>
+#include <av/StreamWriter.hpp>
+
+namespace av
+{
+void writeLog(LogLevel level, internal::SourceLocation&& loc, std::string msg) noexcept
+{
+	std::cerr << loc.toString() << ": " << msg << std::endl;
+}
+}// namespace av
+
+template<typename... Args>
+void println(std::string_view fmt, Args&&... args) noexcept
+{
+	std::cout << av::internal::format(fmt, std::forward<Args>(args)...) << std::endl;
+}
+
+template<typename Return>
+Return assertExpected(av::Expected<Return>&& expected) noexcept
+{
+	if (!expected)
+	{
+		std::cerr << " === Expected failure == \n"
+		          << expected.errorString() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if constexpr (std::is_same_v<Return, void>)
+		return;
+	else
+		return expected.value();
+}
+
+// Changes the container without decoding, e.g. remux input.mp4 output.ts h264_mp4toannexb
+int main(int argc, const char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: remux <input> <output> [video bitstream filters]" << std::endl;
+		return 0;
+	}
+
+	std::string_view input(argv[1]);
+	std::string_view output(argv[2]);
+	const char* videoBsf = argc > 3 ? argv[3] : nullptr;
+
+	// packets are copied as is, so codecs this build can't decode are remuxed too
+	av::StreamSelection selection;
+	selection.openDecoders = false;
+
+	// audio is optional
+	auto readerExp = av::StreamReader::create(input, true, {}, {}, selection);
+	auto reader    = readerExp ? readerExp.value() : assertExpected(av::StreamReader::create(input, false, {}, {}, selection));
+
+	auto writer = assertExpected(av::StreamWriter::create(output));
+
+	const int inVideoIndex  = reader->videoStream()->index;
+	const int outVideoIndex = assertExpected(writer->addCopyStream(reader->videoStream(), videoBsf));
+	const int inAudioIndex  = reader->audioStream() ? reader->audioStream()->index : -1;
+	const int outAudioIndex = reader->audioStream() ? assertExpected(writer->addCopyStream(reader->audioStream())) : -1;
+
+	assertExpected(writer->open());
+
+	const auto start = std::chrono::steady_clock::now();
+
+	av::Packet packet;
+	int count = 0;
+
+	while (assertExpected(reader->readPacket(packet)))
+	{
+		const int streamIndex = packet.native()->stream_index;
+
+		if (streamIndex == inVideoIndex)
+			assertExpected(writer->writePacket(packet, outVideoIndex));
+		else if (streamIndex == inAudioIndex)
+			assertExpected(writer->writePacket(packet, outAudioIndex));
+
+		count++;
+	}
+
+	writer->flushAllStreams();
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	println("Remuxed {} packets in {}s", count, elapsed.count());
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <av/Scale.hpp>
+
+namespace av
+{
+void writeLog(LogLevel level, internal::SourceLocation&& loc, std::string msg) noexcept
+{
+	std::cerr << loc.toString() << ": " << msg << std::endl;
+}
+}// namespace av
+
+template<typename... Args>
+void println(std::string_view fmt, Args&&... args) noexcept
+{
+	std::cout << av::internal::format(fmt, std::forward<Args>(args)...) << std::endl;
+}
+
+template<typename Return>
+Return assertExpected(av::Expected<Return>&& expected) noexcept
+{
+	if (!expected)
+	{
+		std::cerr << " === Expected failure == \n"
+		          << expected.errorString() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if constexpr (std::is_same_v<Return, void>)
+		return;
+	else
+		return expected.value();
+}
+
+// Scales the frame count times and returns scaled fps
+double runScale(av::Frame& src, int outWidth, int outHeight, AVPixelFormat outPixFmt, const av::ScaleParams& params, int count) noexcept
+{
+	auto* in   = src.native();
+	auto scale = assertExpected(av::Scale::create(in->width, in->height, (AVPixelFormat) in->format, outWidth, outHeight, outPixFmt, params));
+	auto dst   = assertExpected(av::Frame::create(outWidth, outHeight, outPixFmt));
+
+	// warm up caches and the pool threads
+	scale->scale(src, *dst);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < count; ++i)
+		scale->scale(src, *dst);
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	return count / elapsed.count();
+}
+
+int main(int argc, const char* argv[])
+{
+	const int count      = argc > 1 ? std::atoi(argv[1]) : 200;
+	const int maxThreads = std::max(1, (int) std::thread::hardware_concurrency());
+
+	auto src = assertExpected(av::Frame::create(3840, 2160, AV_PIX_FMT_YUV420P));
+
+	// gradient so the scaler works on realistic data instead of a constant plane
+	auto* f = src->native();
+	for (int p = 0; p < 3; ++p)
+	{
+		const int h = p == 0 ? f->height : f->height / 2;
+		const int w = p == 0 ? f->width : f->width / 2;
+
+		for (int y = 0; y < h; ++y)
+			for (int x = 0; x < w; ++x)
+				f->data[p][y * f->linesize[p] + x] = (uint8_t) (x + y * (p + 1));
+	}
+
+	struct Case
+	{
+		const char* name;
+		int width;
+		int height;
+		AVPixelFormat pixFmt;
+		int flags;
+		bool fastPaths;
+	};
+
+	const Case cases[] = {
+	    {"3840x2160 yuv420p -> 1920x1080 yuv420p bicubic", 1920, 1080, AV_PIX_FMT_YUV420P, SWS_BICUBIC, true},
+	    {"3840x2160 yuv420p -> 3840x2160 nv12 bicubic", 3840, 2160, AV_PIX_FMT_NV12, SWS_BICUBIC, true},
+	    {"3840x2160 yuv420p -> 3840x2160 rgb24 bicubic", 3840, 2160, AV_PIX_FMT_RGB24, SWS_BICUBIC, true},
+	    {"3840x2160 yuv420p -> 1920x1080 rgb24 bilinear swscale", 1920, 1080, AV_PIX_FMT_RGB24, SWS_BILINEAR, false},
+	    {"3840x2160 yuv420p -> 1920x1080 rgb24 bilinear kernel", 1920, 1080, AV_PIX_FMT_RGB24, SWS_BILINEAR, true},
+	    {"3840x2160 yuv420p -> 960x540 bgr24 point swscale", 960, 540, AV_PIX_FMT_BGR24, SWS_POINT, false},
+	    {"3840x2160 yuv420p -> 960x540 bgr24 point kernel", 960, 540, AV_PIX_FMT_BGR24, SWS_POINT, true},
+	};
+
+	for (const auto& c : cases)
+	{
+		println("{}", c.name);
+
+		for (int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			av::ScaleParams params;
+			params.threads   = threads;
+			params.flags     = c.flags;
+			params.fastPaths = c.fastPaths;
+
+			println("threads: {} fps: {}", threads, runScale(*src, c.width, c.height, c.pixFmt, params, count));
+		}
+	}
+
+	return 0;
+}
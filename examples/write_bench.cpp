@@ -0,0 +1,116 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+#include <av/AsyncFileWriter.hpp>
+
+namespace av
+{
+void writeLog(LogLevel level, internal::SourceLocation&& loc, std::string msg) noexcept
+{
+	std::cerr << loc.toString() << ": " << msg << std::endl;
+}
+}// namespace av
+
+template<typename... Args>
+void println(std::string_view fmt, Args&&... args) noexcept
+{
+	std::cout << av::internal::format(fmt, std::forward<Args>(args)...) << std::endl;
+}
+
+template<typename Return>
+Return assertExpected(av::Expected<Return>&& expected) noexcept
+{
+	if (!expected)
+	{
+		std::cerr << " === Expected failure == \n"
+		          << expected.errorString() << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if constexpr (std::is_same_v<Return, void>)
+		return;
+	else
+		return expected.value();
+}
+
+// Size of 7 mpegts packets, a typical chunk muxers hand to avio_write
+constexpr int kChunkSize = 188 * 7;
+
+struct WriteStats
+{
+	// time spent in avio_write, i.e. how long a muxer would be blocked
+	double writeSec;
+	// total time including flushing and closing the file
+	double totalSec;
+};
+
+WriteStats runWrite(AVIOContext* pb, size_t totalBytes, const std::function<void()>& close) noexcept
+{
+	std::vector<uint8_t> chunk(kChunkSize);
+	for (size_t i = 0; i < chunk.size(); ++i)
+		chunk[i] = (uint8_t) i;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (size_t written = 0; written < totalBytes; written += chunk.size())
+		avio_write(pb, chunk.data(), (int) chunk.size());
+
+	avio_flush(pb);
+
+	const auto written = std::chrono::steady_clock::now();
+
+	close();
+
+	const auto end = std::chrono::steady_clock::now();
+
+	return {std::chrono::duration<double>(written - start).count(), std::chrono::duration<double>(end - start).count()};
+}
+
+void printStats(std::string_view name, size_t totalBytes, const WriteStats& stats) noexcept
+{
+	const double mb = totalBytes / (1024.0 * 1024.0);
+	println("{}: write {}s ({} MB/s) total {}s ({} MB/s)", name, stats.writeSec, mb / stats.writeSec, stats.totalSec, mb / stats.totalSec);
+}
+
+int main(int argc, const char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: write_bench <output file> [size MB] [buffer MB]" << std::endl;
+		return 0;
+	}
+
+	const std::string output(argv[1]);
+	const size_t totalBytes = (size_t)(argc > 2 ? std::atoi(argv[2]) : 1024) * 1024 * 1024;
+	const size_t bufferSize = (size_t)(argc > 3 ? std::atoi(argv[3]) : 4) * 1024 * 1024;
+
+	{
+		AVIOContext* pb = nullptr;
+		auto err        = avio_open(&pb, ("file:" + output).c_str(), AVIO_FLAG_WRITE);
+		if (err < 0)
+		{
+			std::cerr << "Failed to open output: " << av::avErrorStr(err) << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		printStats("file protocol", totalBytes, runWrite(pb, totalBytes, [&] { avio_closep(&pb); }));
+	}
+
+	for (bool directIO : {false, true})
+	{
+		av::AsyncFileWriterParams params;
+		params.bufferSize = bufferSize;
+		params.directIO   = directIO;
+
+		auto writer = assertExpected(av::AsyncFileWriter::create(output, params));
+		auto write  = [writer](const uint8_t* buf, int size) { return writer->write(buf, size); };
+		auto seek   = [writer](int64_t offset, int whence) { return writer->seek(offset, whence); };
+		auto io     = assertExpected(av::IOContext::createWriter(write, seek));
+
+		auto stats = runWrite(io->native(), totalBytes, [&] { assertExpected(writer->close()); });
+		printStats(directIO ? "async O_DIRECT" : "async", totalBytes, stats);
+	}
+
+	return 0;
+}